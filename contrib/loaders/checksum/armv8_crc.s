@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2020, Ampere Computing LLC                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.           *
+ ***************************************************************************/
+
+/*
+	parameters:
+	x0 - address in - crc out
+	x1 - char count
+
+	Computes the same MSB-first CRC32 (poly 0x04C11DB7, init 0xffffffff)
+	as image_calculate_checksum() using the reflected CRC32 instructions:
+	every input byte is bit reversed before it is fed to crc32, and the
+	accumulator is bit reversed on exit. The head is consumed bytewise up
+	to a doubleword boundary so that no unaligned loads are issued, which
+	keeps the code usable with the MMU off (Device memory).
+*/
+
+	.text
+	.arch	armv8-a+crc
+
+	.align	2
+
+_start:
+main:
+	mov	x2, x0
+	mov	w0, #0xffffffff
+
+head_loop:
+	cbz	x1, done
+	tst	x2, #7
+	b.eq	dword_loop
+	ldrb	w3, [x2], #1
+	rbit	w3, w3
+	lsr	w3, w3, #24
+	crc32b	w0, w0, w3
+	sub	x1, x1, #1
+	b	head_loop
+
+dword_loop:
+	cmp	x1, #8
+	b.lo	tail_loop
+	ldr	x3, [x2], #8
+	rbit	x3, x3
+	rev	x3, x3
+	crc32x	w0, w0, x3
+	sub	x1, x1, #8
+	b	dword_loop
+
+tail_loop:
+	cbz	x1, done
+	ldrb	w3, [x2], #1
+	rbit	w3, w3
+	lsr	w3, w3, #24
+	crc32b	w0, w0, w3
+	sub	x1, x1, #1
+	b	tail_loop
+
+done:
+	rbit	w0, w0
+	hlt	#0xb
+
+	.end
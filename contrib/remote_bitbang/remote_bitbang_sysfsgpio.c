@@ -291,6 +291,48 @@ static void cleanup_all_fds(void)
 	cleanup_fd(srst_fd, srst_gpio);
 }
 
+/*
+ * Block extension: the bit count as 32 bit little endian, then the TMS and
+ * the TDI bit vectors. The sampled TDO bits are sent back if capture is set.
+ */
+static int process_block(int capture)
+{
+	unsigned char len[4];
+	if (fread(len, sizeof(len), 1, stdin) != 1)
+		return ERROR_FAIL;
+
+	size_t bits = len[0] | len[1] << 8 | len[2] << 16 | (size_t)len[3] << 24;
+	size_t bytes = (bits + 7) / 8;
+	unsigned char *tms = malloc(bytes);
+	unsigned char *tdi = malloc(bytes);
+	unsigned char *tdo = calloc(bytes, 1);
+	int retval = ERROR_FAIL;
+
+	if (!tms || !tdi || !tdo)
+		goto out;
+	if (bytes && (fread(tms, bytes, 1, stdin) != 1 || fread(tdi, bytes, 1, stdin) != 1))
+		goto out;
+
+	for (size_t i = 0; i < bits; i++) {
+		int tms_bit = (tms[i / 8] >> (i % 8)) & 1;
+		int tdi_bit = (tdi[i / 8] >> (i % 8)) & 1;
+		sysfsgpio_write(0, tms_bit, tdi_bit);
+		if (capture && sysfsgpio_read() == '1')
+			tdo[i / 8] |= 1 << (i % 8);
+		sysfsgpio_write(1, tms_bit, tdi_bit);
+	}
+
+	if (capture && bytes && fwrite(tdo, bytes, 1, stdout) != 1)
+		goto out;
+	retval = ERROR_OK;
+
+out:
+	free(tms);
+	free(tdi);
+	free(tdo);
+	return retval;
+}
+
 static void process_remote_protocol(void)
 {
 	int c;
@@ -311,7 +353,14 @@ static void process_remote_protocol(void)
 					(d & 1));
 		} else if (c == 'R')
 			putchar(sysfsgpio_read());
-		else
+		else if (c == 'X') /* Block extension, version 1 */
+			fputs("X1", stdout);
+		else if (c == 'S' || c == 'T') {
+			if (process_block(c == 'S') != ERROR_OK) {
+				LOG_ERROR("Truncated block command");
+				break;
+			}
+		} else
 			LOG_ERROR("Unknown command '%c' received", c);
 	}
 }
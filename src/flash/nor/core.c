@@ -734,8 +734,189 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/**
+ * A contiguous, padded block of image data destined for one flash bank.
+ */
+struct flash_write_run {
+	struct flash_bank *bank;
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;
+};
+
+/* image data prepared on the host before it is programmed; a single run can
+ * still be larger */
+#define FLASH_WRITE_PREPARE_MAX	(16 * 1024 * 1024)
+
+/* incremental writes compare flash contents in chunks of at least this size */
+#define FLASH_INCREMENTAL_CHUNK	0x10000
+
+static int flash_write_range(struct target *target, struct flash_bank *bank,
+	const uint8_t *buffer, target_addr_t address, uint32_t size,
+	bool erase, bool unlock, bool write, bool verify)
+{
+	int retval = ERROR_OK;
+
+	if (unlock)
+		retval = flash_unlock_address_range(target, address, size);
+	if (retval == ERROR_OK) {
+		if (erase) {
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, address, size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		if (write) {
+			/* write flash sectors */
+			retval = flash_driver_write(bank, buffer, address - bank->base, size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		if (verify) {
+			/* verify flash sectors */
+			retval = flash_driver_verify(bank, buffer, address - bank->base, size);
+		}
+	}
+
+	return retval;
+}
+
+/**
+ * Compare a chunk of flash with the image. The driver's verify method is
+ * used if it has one, and an on-target checksum if the bank is memory
+ * mapped. Other banks (e.g. SPI flash behind jtagspi) are read back
+ * through the driver, since a checksum of bank->base would not see them.
+ */
+static int flash_chunk_unchanged(struct flash_bank *bank,
+	const uint8_t *data, uint32_t offset, uint32_t count, bool *unchanged)
+{
+	if (bank->driver->verify || bank->driver->read == default_flash_read) {
+		int retval = bank->driver->verify ?
+			bank->driver->verify(bank, data, offset, count) :
+			default_flash_verify(bank, data, offset, count);
+		*unchanged = (retval == ERROR_OK);
+		return ERROR_OK;
+	}
+
+	uint8_t *current = malloc(count);
+	if (!current) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = flash_driver_read(bank, current, offset, count);
+	if (retval == ERROR_OK)
+		*unchanged = (memcmp(current, data, count) == 0);
+
+	free(current);
+	return retval;
+}
+
+/**
+ * Write a run, skipping the sector-aligned chunks whose flash contents
+ * already match the image, and adjacent differing chunks are erased and
+ * programmed together. The run must have been padded to the end of its
+ * last sector, as for erase.
+ */
+static int flash_write_run_incremental(struct target *target,
+	struct flash_write_run *run, bool unlock, bool verify, uint32_t *skipped)
+{
+	struct flash_bank *bank = run->bank;
+	uint32_t run_offset = run->address - bank->base;
+	uint32_t run_end = run_offset + run->size;
+	uint32_t chunk_start = run_offset;
+	uint32_t dirty_start = run_offset, dirty_end = run_offset;
+	unsigned int sector = 0;
+	int retval = ERROR_OK;
+
+	while (chunk_start < run_end) {
+		uint32_t chunk_end = run_end;
+
+		/* extend the chunk to a sector boundary */
+		for (; sector < bank->num_sectors; sector++) {
+			uint32_t sector_end = bank->sectors[sector].offset
+				+ bank->sectors[sector].size;
+			if (sector_end >= run_end)
+				break;
+			if (sector_end > chunk_start
+					&& sector_end - chunk_start >= FLASH_INCREMENTAL_CHUNK) {
+				chunk_end = sector_end;
+				sector++;
+				break;
+			}
+		}
+
+		const uint8_t *data = run->buffer + (chunk_start - run_offset);
+		uint32_t count = chunk_end - chunk_start;
+		bool unchanged = false;
+		retval = flash_chunk_unchanged(bank, data, chunk_start, count, &unchanged);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (unchanged) {
+			*skipped += count;
+			if (dirty_end > dirty_start) {
+				retval = flash_write_range(target, bank,
+						run->buffer + (dirty_start - run_offset),
+						bank->base + dirty_start, dirty_end - dirty_start,
+						true, unlock, true, verify);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+			dirty_start = dirty_end = chunk_end;
+		} else {
+			dirty_end = chunk_end;
+		}
+
+		chunk_start = chunk_end;
+	}
+
+	if (dirty_end > dirty_start)
+		retval = flash_write_range(target, bank,
+				run->buffer + (dirty_start - run_offset),
+				bank->base + dirty_start, dirty_end - dirty_start,
+				true, unlock, true, verify);
+
+	return retval;
+}
+
+/* Program the prepared runs and free their buffers */
+static int flash_write_runs(struct target *target,
+	struct flash_write_run *runs, unsigned int num_runs, uint32_t *written,
+	bool erase, bool unlock, bool write, bool verify, bool incremental,
+	uint32_t *skipped)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < num_runs && retval == ERROR_OK; i++) {
+		struct flash_write_run *run = &runs[i];
+		uint32_t run_skipped = 0;
+
+		if (incremental && write)
+			retval = flash_write_run_incremental(target, run,
+					unlock, verify, &run_skipped);
+		else
+			retval = flash_write_range(target, run->bank, run->buffer,
+					run->address, run->size, erase, unlock, write, verify);
+
+		free(run->buffer);
+		run->buffer = NULL;
+
+		/* count only the bytes actually programmed */
+		*skipped += run_skipped;
+		if (retval == ERROR_OK && written != NULL)
+			*written += run->size - run_skipped;
+	}
+
+	return retval;
+}
+
 int flash_write_unlock_verify(struct target *target, struct image *image,
-	uint32_t *written, bool erase, bool unlock, bool write, bool verify)
+	uint32_t *written, bool erase, bool unlock, bool write, bool verify,
+	bool incremental)
 {
 	int retval = ERROR_OK;
 
@@ -743,6 +924,10 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 	uint32_t section_offset;
 	struct flash_bank *c;
 	int *padding;
+	struct flash_write_run *runs = NULL;
+	unsigned int num_runs = 0, max_runs = 0;
+	uint32_t prepared = 0;
+	uint32_t skipped = 0;
 
 	section = 0;
 	section_offset = 0;
@@ -750,6 +935,10 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 	if (written)
 		*written = 0;
 
+	/* NOR can only clear bits, so differing chunks are always erased */
+	if (incremental && write)
+		erase = true;
+
 	if (erase) {
 		/* assume all sectors need erasing - stops any problems
 		 * when flash_write is called multiple times */
@@ -771,7 +960,11 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 	qsort(sections, image->num_sections, sizeof(struct imagesection *),
 		compare_section);
 
-	/* loop until we reach end of the image */
+	/* Read and pad the image on the host in batches of runs of up to
+	 * FLASH_WRITE_PREPARE_MAX bytes and program each batch in one go. This
+	 * keeps host file I/O out of the target side sequence of flash
+	 * operations, bounds the host memory, and makes an image no larger than
+	 * a batch abort on a read error before anything got erased. */
 	while (section < image->num_sections) {
 		uint32_t buffer_idx;
 		uint8_t *buffer;
@@ -936,7 +1129,11 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 				buffer_idx, size_read);
 			retval = image_read_section(image, t_section_num, section_offset,
 					size_read, buffer + buffer_idx, &size_read);
-			if (retval != ERROR_OK || size_read == 0) {
+			if (retval == ERROR_OK && size_read == 0) {
+				LOG_ERROR("Image section %d is truncated", t_section_num);
+				retval = ERROR_FAIL;
+			}
+			if (retval != ERROR_OK) {
 				free(buffer);
 				goto done;
 			}
@@ -956,44 +1153,46 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			}
 		}
 
-		retval = ERROR_OK;
-
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+		if (num_runs == max_runs) {
+			unsigned int n = max_runs ? 2 * max_runs : 8;
+			struct flash_write_run *r = realloc(runs, n * sizeof(*runs));
+			if (r == NULL) {
+				LOG_ERROR("Out of memory for flash bank buffer");
+				free(buffer);
+				retval = ERROR_FAIL;
+				goto done;
 			}
+			runs = r;
+			max_runs = n;
 		}
 
-		if (retval == ERROR_OK) {
-			if (write) {
-				/* write flash sectors */
-				retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
-			}
-		}
+		runs[num_runs].bank = c;
+		runs[num_runs].address = run_address;
+		runs[num_runs].size = run_size;
+		runs[num_runs].buffer = buffer;
+		num_runs++;
 
-		if (retval == ERROR_OK) {
-			if (verify) {
-				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
-			}
+		prepared += run_size;
+		if (prepared >= FLASH_WRITE_PREPARE_MAX) {
+			retval = flash_write_runs(target, runs, num_runs, written,
+					erase, unlock, write, verify, incremental, &skipped);
+			if (retval != ERROR_OK)
+				goto done;
+			num_runs = 0;
+			prepared = 0;
 		}
+	}
 
-		free(buffer);
-
-		if (retval != ERROR_OK) {
-			/* abort operation */
-			goto done;
-		}
+	retval = flash_write_runs(target, runs, num_runs, written,
+			erase, unlock, write, verify, incremental, &skipped);
 
-		if (written != NULL)
-			*written += run_size;	/* add run size to total written counter */
-	}
+	if (incremental && write && retval == ERROR_OK)
+		LOG_INFO("%" PRIu32 " bytes unchanged, not reprogrammed", skipped);
 
 done:
+	for (unsigned int i = 0; i < num_runs; i++)
+		free(runs[i].buffer);
+	free(runs);
 	free(sections);
 	free(padding);
 
@@ -1003,7 +1202,7 @@ done:
 int flash_write(struct target *target, struct image *image,
 	uint32_t *written, bool erase)
 {
-	return flash_write_unlock_verify(target, image, written, erase, false, true, false);
+	return flash_write_unlock_verify(target, image, written, erase, false, true, false, false);
 }
 
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size,
@@ -48,8 +48,11 @@ int flash_driver_read(struct flash_bank *bank,
 int flash_driver_verify(struct flash_bank *bank,
 		const uint8_t *buffer, uint32_t offset, uint32_t count);
 
-/* write (optional verify) an image to flash memory of the given target */
+/* write (optional verify) an image to flash memory of the given target,
+ * with incremental set only the parts differing from the image are erased
+ * and written */
 int flash_write_unlock_verify(struct target *target, struct image *image,
-		uint32_t *written, bool erase, bool unlock, bool write, bool verify);
+		uint32_t *written, bool erase, bool unlock, bool write, bool verify,
+		bool incremental);
 
 #endif /* OPENOCD_FLASH_NOR_IMP_H */
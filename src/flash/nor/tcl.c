@@ -413,6 +413,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	/* flash auto-erase is disabled by default*/
 	int auto_erase = 0;
 	bool auto_unlock = false;
+	bool incremental = false;
 
 	while (CMD_ARGC) {
 		if (strcmp(CMD_ARGV[0], "erase") == 0) {
@@ -425,6 +426,11 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "incremental") == 0) {
+			incremental = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+			command_print(CMD, "incremental write enabled");
 		} else
 			break;
 	}
@@ -455,7 +461,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 		return retval;
 
 	retval = flash_write_unlock_verify(target, &image, &written, auto_erase,
-		auto_unlock, true, false);
+		auto_unlock, true, false, incremental);
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -507,7 +513,7 @@ COMMAND_HANDLER(handle_flash_verify_image_command)
 		return retval;
 
 	retval = flash_write_unlock_verify(target, &image, &verified, false,
-		false, false, true);
+		false, false, true, false);
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -1193,9 +1199,10 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] [incremental] filename [offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
-			"and/or erase the region to be used. Allow optional "
+			"and/or erase the region to be used, or skip the parts "
+			"already holding the image. Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
 	{
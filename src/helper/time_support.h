@@ -42,6 +42,37 @@ int timeval_compare(const struct timeval *x, const struct timeval *y);
 
 /** @returns gettimeofday() timeval as 64-bit in ms */
 int64_t timeval_ms(void);
+/** @returns gettimeofday() timeval as 64-bit in us */
+int64_t timeval_us(void);
+
+#define LATENCY_HIST_BUCKETS 16
+
+/**
+ * Log2 histogram of durations. Bucket 0 counts durations below 1us,
+ * bucket n (n > 0) those in [2^(n-1), 2^n) us, and the last bucket
+ * everything above.
+ */
+struct latency_hist {
+	uint64_t count;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint64_t bucket[LATENCY_HIST_BUCKETS];
+};
+
+/** Account a duration of @a us microseconds in @a hist. */
+void latency_hist_add(struct latency_hist *hist, int64_t us);
+
+struct command_invocation;
+
+/** Print one line per non-empty bucket of @a hist. */
+void latency_hist_print(struct command_invocation *cmd,
+		const struct latency_hist *hist);
+
+/** Room needed by latency_hist_json(), including the terminator. */
+#define LATENCY_HIST_JSON_MAX (LATENCY_HIST_BUCKETS * 22)
+
+/** Format the buckets of @a hist as the elements of a JSON array. */
+void latency_hist_json(const struct latency_hist *hist, char *buf, size_t size);
 
 struct duration {
 	struct timeval start;
@@ -27,6 +27,7 @@
 #endif
 
 #include "time_support.h"
+#include "command.h"
 
 /* simple and low overhead fetching of ms counter. Use only
  * the difference between ms counters returned from this fn.
@@ -39,3 +40,52 @@ int64_t timeval_ms(void)
 		return retval;
 	return (int64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
 }
+
+int64_t timeval_us(void)
+{
+	struct timeval now;
+	int retval = gettimeofday(&now, NULL);
+	if (retval < 0)
+		return retval;
+	return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+void latency_hist_add(struct latency_hist *hist, int64_t us)
+{
+	unsigned int n = 0;
+
+	if (us < 0)
+		us = 0;
+	while (n < LATENCY_HIST_BUCKETS - 1 && (us >> n))
+		n++;
+
+	hist->count++;
+	hist->total_us += us;
+	if ((uint64_t)us > hist->max_us)
+		hist->max_us = us;
+	hist->bucket[n]++;
+}
+
+void latency_hist_print(struct command_invocation *cmd,
+		const struct latency_hist *hist)
+{
+	for (unsigned int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+		if (!hist->bucket[i])
+			continue;
+		if (i == LATENCY_HIST_BUCKETS - 1)
+			command_print(cmd, "  >= %6u us: %" PRIu64, 1u << (i - 1), hist->bucket[i]);
+		else
+			command_print(cmd, "   < %6u us: %" PRIu64, 1u << i, hist->bucket[i]);
+	}
+}
+
+void latency_hist_json(const struct latency_hist *hist, char *buf, size_t size)
+{
+	size_t len = 0;
+
+	if (size)
+		buf[0] = '\0';
+	for (unsigned int i = 0; i < LATENCY_HIST_BUCKETS && len < size; i++)
+		len += snprintf(buf + len, size - len, "%s%" PRIu64,
+				i ? ", " : "", hist->bucket[i]);
+}
@@ -497,6 +497,51 @@ COMMAND_HANDLER(handle_adapter_reset_de_assert)
 						  (srst == VALUE_DEASSERT) ? SRST_DEASSERT : SRST_ASSERT);
 }
 
+COMMAND_HANDLER(handle_adapter_stats_command)
+{
+	const struct jtag_stats *stats = jtag_get_stats();
+	bool json = false;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "reset")) {
+			jtag_reset_stats();
+			return ERROR_OK;
+		}
+		if (strcmp(CMD_ARGV[0], "json"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		json = true;
+	}
+
+	if (json) {
+		char buckets[LATENCY_HIST_JSON_MAX];
+
+		latency_hist_json(&stats->flushes, buckets, sizeof(buckets));
+
+		command_print(CMD, "{\"adapter\": \"%s\", \"ir_scans\": %" PRIu64
+				", \"dr_scans\": %" PRIu64 ", \"scan_bits\": %" PRIu64
+				", \"idle_clocks\": %" PRIu64 ", \"flushes\": %" PRIu64
+				", \"flush_us\": %" PRIu64 ", \"flush_us_max\": %" PRIu64
+				", \"flush_us_log2\": [%s]}",
+				adapter_driver ? adapter_driver->name : "undefined", stats->ir_scans, stats->dr_scans,
+				stats->scan_bits, stats->idle_clocks, stats->flushes.count,
+				stats->flushes.total_us, stats->flushes.max_us, buckets);
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "IR/DR scans:  %" PRIu64 "/%" PRIu64,
+			stats->ir_scans, stats->dr_scans);
+	command_print(CMD, "scanned bits: %" PRIu64, stats->scan_bits);
+	command_print(CMD, "idle clocks:  %" PRIu64, stats->idle_clocks);
+	command_print(CMD, "flushes:      %" PRIu64 ", %" PRIu64 " us total, %" PRIu64 " us max",
+			stats->flushes.count, stats->flushes.total_us, stats->flushes.max_us);
+	latency_hist_print(CMD, &stats->flushes);
+
+	return ERROR_OK;
+}
+
 #ifndef HAVE_JTAG_MINIDRIVER_H
 #ifdef HAVE_LIBUSB_GET_PORT_NUMBERS
 COMMAND_HANDLER(handle_usb_location_command)
@@ -597,6 +642,14 @@ static const struct command_registration adapter_command_handlers[] = {
 		.chain = adapter_usb_command_handlers,
 	},
 #endif /* MINIDRIVER */
+	{
+		.name = "stats",
+		.handler = handle_adapter_stats_command,
+		.mode = COMMAND_ANY,
+		.help = "display, reset or export as JSON the JTAG scan "
+			"counters and queue flush latencies",
+		.usage = "['reset'|'json']",
+	},
 	{
 		.name = "assert",
 		.handler = handle_adapter_reset_de_assert,
@@ -50,6 +50,8 @@ static int jtag_flush_queue_count;
 /* Sleep this # of ms after flushing the queue */
 static int jtag_flush_queue_sleep;
 
+static struct jtag_stats jtag_stats;
+
 static void jtag_add_scan_check(struct jtag_tap *active,
 		void (*jtag_add_scan)(struct jtag_tap *active,
 		int in_num_fields,
@@ -357,6 +359,9 @@ void jtag_add_ir_scan_noverify(struct jtag_tap *active, const struct scan_field
 {
 	jtag_prelude(state);
 
+	jtag_stats.ir_scans++;
+	jtag_stats.scan_bits += in_fields->num_bits;
+
 	int retval = interface_jtag_add_ir_scan(active, in_fields, state);
 	jtag_set_error(retval);
 }
@@ -396,6 +401,9 @@ void jtag_add_plain_ir_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 
 	jtag_prelude(state);
 
+	jtag_stats.ir_scans++;
+	jtag_stats.scan_bits += num_bits;
+
 	int retval = interface_jtag_add_plain_ir_scan(
 			num_bits, out_bits, in_bits, state);
 	jtag_set_error(retval);
@@ -457,6 +465,10 @@ void jtag_add_dr_scan(struct jtag_tap *active,
 
 	jtag_prelude(state);
 
+	jtag_stats.dr_scans++;
+	for (int i = 0; i < in_num_fields; i++)
+		jtag_stats.scan_bits += in_fields[i].num_bits;
+
 	int retval;
 	retval = interface_jtag_add_dr_scan(active, in_num_fields, in_fields, state);
 	jtag_set_error(retval);
@@ -470,6 +482,9 @@ void jtag_add_plain_dr_scan(int num_bits, const uint8_t *out_bits, uint8_t *in_b
 
 	jtag_prelude(state);
 
+	jtag_stats.dr_scans++;
+	jtag_stats.scan_bits += num_bits;
+
 	int retval;
 	retval = interface_jtag_add_plain_dr_scan(num_bits, out_bits, in_bits, state);
 	jtag_set_error(retval);
@@ -592,6 +607,7 @@ int jtag_add_statemove(tap_state_t goal_state)
 void jtag_add_runtest(int num_cycles, tap_state_t state)
 {
 	jtag_prelude(state);
+	jtag_stats.idle_clocks += num_cycles;
 	jtag_set_error(interface_jtag_add_runtest(num_cycles, state));
 }
 
@@ -607,6 +623,7 @@ void jtag_add_clocks(int num_cycles)
 
 	if (num_cycles > 0) {
 		jtag_checks();
+		jtag_stats.idle_clocks += num_cycles;
 		jtag_set_error(interface_jtag_add_clocks(num_cycles));
 	}
 }
@@ -1025,7 +1042,10 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
+
+	int64_t start = timeval_us();
 	jtag_set_error(interface_jtag_execute_queue());
+	latency_hist_add(&jtag_stats.flushes, timeval_us() - start);
 
 	if (jtag_flush_queue_sleep > 0) {
 		/* For debug purposes it can be useful to test performance
@@ -1041,6 +1061,16 @@ int jtag_get_flush_queue_count(void)
 	return jtag_flush_queue_count;
 }
 
+const struct jtag_stats *jtag_get_stats(void)
+{
+	return &jtag_stats;
+}
+
+void jtag_reset_stats(void)
+{
+	memset(&jtag_stats, 0, sizeof(jtag_stats));
+}
+
 int jtag_execute_queue(void)
 {
 	jtag_execute_queue_noclear();
@@ -0,0 +1,1464 @@
+/***************************************************************************
+ *                                                                         *
+ *   Copyright (C) 2020, Ampere Computing LLC                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/**
+ * @file
+ * In-process model of an ADIv6 debug port, for running the arm_adi_v6 and
+ * aarch64 code without hardware.
+ *
+ * The model is a DPv3 with two MEM-APs:
+ *  - AP #0, an APB-AP holding a class 9 ROM table followed by one ARMv8
+ *    external debug block and one CTI per simulated PE;
+ *  - AP #1, an AXI-AP onto the memory regions given with "adisim memory".
+ *
+ * The PEs do not execute code. A running PE sits still until it is halted
+ * through its CTI; a halted PE executes the small A64 subset issued through
+ * EDITR (system register moves, DCC transfers, DCPS/DRPS, MOV to/from SP,
+ * post-indexed loads and stores and SIMD moves), including memory access
+ * mode. This is enough for halt/resume/step of SMP groups, register access
+ * and CPU or AP memory transfers, but not for running algorithms on target.
+ *
+ * Transfers execute as they are queued. Each run() then sleeps for the
+ * configured round trip latency plus the wire time of the queued transfers
+ * at the current adapter speed, and WAIT responses can be injected to cost
+ * extra transfers, so relative performance of host side changes can be
+ * measured on any machine.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/time_support.h>
+#include <jtag/interface.h>
+#include <target/armv8.h>
+#include <target/armv8_opcodes.h>
+#include <target/arm_adi_v6.h>
+#include <transport/transport.h>
+
+#define ADISIM_MAX_CORES	64
+#define ADISIM_MAX_REGIONS	8
+#define ADISIM_MAX_SYSREGS	64
+#define ADISIM_NUM_BRP		6
+#define ADISIM_NUM_WRP		4
+
+#define ADISIM_DPIDR		0x0be03477	/* DPv3, designer ARM */
+#define ADISIM_DPIDR1		0x00000020	/* 32-bit ROM table addresses */
+
+#define ADISIM_APB_AP		0
+#define ADISIM_AXI_AP		1
+#define ADISIM_APB_IDR		0x44770002
+#define ADISIM_AXI_IDR		0x34770004
+
+/* APB address map: ROM table, then 128KiB per PE holding debug and CTI */
+#define ADISIM_ROM_BASE		0x00000000
+#define ADISIM_PE_BASE		0x00010000
+#define ADISIM_PE_STRIDE	0x00020000
+#define ADISIM_CTI_OFFSET	0x00010000
+#define ADISIM_DBG_BASE(n)	(ADISIM_PE_BASE + (n) * ADISIM_PE_STRIDE)
+#define ADISIM_CTI_BASE(n)	(ADISIM_DBG_BASE(n) + ADISIM_CTI_OFFSET)
+
+/* ID values of a Cortex-A53, which the ROM table decoder knows */
+#define ADISIM_MIDR			0x410fd034
+#define ADISIM_DBG_PART		0xd03
+#define ADISIM_CTI_PART		0x9a8
+#define ADISIM_DFR0			(0x10000008 | ((ADISIM_NUM_WRP - 1) << 20) | ((ADISIM_NUM_BRP - 1) << 12))
+#define ADISIM_MMFR0		0x00101122
+#define ADISIM_CTR			0x8444c004
+
+/* SWD clocks of one transfer including turnarounds and idle cycles */
+#define ADISIM_XFER_CLOCKS	46
+
+#define ADISIM_DSCR_RW		(DSCR_HDE | DSCR_MA | DSCR_TDA | DSCR_INTDIS_MASK)
+#define ADISIM_EDECR_RCE	(1 << 1)
+#define ADISIM_EDECR_SS		(1 << 2)
+
+struct adisim_region {
+	uint64_t base;
+	uint64_t size;
+	uint8_t *data;
+};
+
+struct adisim_sysreg {
+	uint16_t key;
+	uint64_t value;
+};
+
+struct adisim_cti {
+	uint32_t ctrl;
+	uint32_t gate;
+	uint32_t appset;
+	uint32_t trout;
+	uint32_t inen[8];
+	uint32_t outen[8];
+};
+
+struct adisim_pe {
+	/* execution state */
+	bool halted;
+	uint32_t reason;
+	unsigned int el;
+	uint64_t pc;
+	uint64_t x[31];
+	uint64_t sp;
+	uint64_t v[32][2];
+	uint64_t dlr;
+	uint32_t dspsr;
+	struct adisim_sysreg sysregs[ADISIM_MAX_SYSREGS];
+	unsigned int num_sysregs;
+
+	/* external debug interface */
+	uint32_t dscr;
+	uint32_t edecr;
+	uint32_t dtrrx, dtrtx;
+	bool rxfull, txfull;
+	bool err, txu, rto, ito;
+	bool oslk, sdr, sr;
+	unsigned int itr_busy;
+	uint32_t bvr[ADISIM_NUM_BRP][2], bcr[ADISIM_NUM_BRP];
+	uint32_t wvr[ADISIM_NUM_WRP][2], wcr[ADISIM_NUM_WRP];
+
+	struct adisim_cti cti;
+};
+
+struct adisim_ap {
+	uint32_t idr;
+	uint32_t cfg;
+	uint32_t base;
+	uint32_t csw;
+	uint64_t tar;
+};
+
+struct adisim_stats {
+	uint64_t runs;
+	uint64_t transfers;
+	uint64_t waits;
+	uint64_t faults;
+	uint64_t instructions;
+	uint64_t wait_us;
+};
+
+static struct {
+	/* configuration */
+	unsigned int num_pes;
+	struct adisim_region regions[ADISIM_MAX_REGIONS];
+	unsigned int num_regions;
+	unsigned int latency_us;
+	unsigned int wait_percent;
+	unsigned int itr_latency;
+	int khz;
+
+	/* state */
+	struct adisim_pe *pes;
+	struct adisim_ap aps[2];
+	uint32_t ctrl_stat;
+	uint32_t select;
+	bool srst;
+	uint32_t rand;
+	unsigned int pending;
+	bool fault;
+
+	struct adisim_stats stats;
+} adisim = {
+	.num_pes = 4,
+	.rand = 0x2545f491,
+};
+
+/*----------------------------------------------------------------------*/
+/* backing store */
+
+static uint8_t *adisim_mem_ptr(uint64_t address, uint32_t size)
+{
+	for (unsigned int i = 0; i < adisim.num_regions; i++) {
+		struct adisim_region *r = &adisim.regions[i];
+
+		if (address >= r->base && address - r->base + size <= r->size)
+			return r->data + (address - r->base);
+	}
+
+	return NULL;
+}
+
+static bool adisim_mem_read(uint64_t address, uint32_t size, uint64_t *value)
+{
+	uint8_t *p = adisim_mem_ptr(address, size);
+
+	if (!p)
+		return false;
+
+	*value = 0;
+	for (uint32_t i = 0; i < size; i++)
+		*value |= (uint64_t)p[i] << (8 * i);
+
+	return true;
+}
+
+static bool adisim_mem_write(uint64_t address, uint32_t size, uint64_t value)
+{
+	uint8_t *p = adisim_mem_ptr(address, size);
+
+	if (!p)
+		return false;
+
+	for (uint32_t i = 0; i < size; i++)
+		p[i] = value >> (8 * i);
+
+	return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* processing element */
+
+static uint64_t adisim_xreg(struct adisim_pe *pe, unsigned int n, bool sp)
+{
+	if (n == 31)
+		return sp ? pe->sp : 0;
+	return pe->x[n];
+}
+
+static void adisim_set_xreg(struct adisim_pe *pe, unsigned int n, uint64_t value, bool sp)
+{
+	if (n < 31)
+		pe->x[n] = value;
+	else if (sp)
+		pe->sp = value;
+}
+
+static uint32_t adisim_pstate(struct adisim_pe *pe)
+{
+	/* ELxh, all exceptions masked */
+	return 0x3c0 | (pe->el << 2) | (pe->el ? 1 : 0);
+}
+
+static struct adisim_sysreg *adisim_sysreg_find(struct adisim_pe *pe, uint16_t key, bool create)
+{
+	for (unsigned int i = 0; i < pe->num_sysregs; i++) {
+		if (pe->sysregs[i].key == key)
+			return &pe->sysregs[i];
+	}
+
+	if (!create || pe->num_sysregs == ADISIM_MAX_SYSREGS)
+		return NULL;
+
+	struct adisim_sysreg *reg = &pe->sysregs[pe->num_sysregs++];
+	reg->key = key;
+	reg->value = 0;
+	return reg;
+}
+
+static uint64_t adisim_mrs(struct adisim_pe *pe, uint16_t key)
+{
+	unsigned int index = pe - adisim.pes;
+
+	switch (key) {
+	case SYSTEM_DBG_DBGDTR_EL0:
+		pe->rxfull = false;
+		return (uint64_t)pe->dtrtx << 32 | pe->dtrrx;
+	case SYSTEM_DBG_DTRRX_EL0:
+		pe->rxfull = false;
+		return pe->dtrrx;
+	case SYSTEM_DBG_DLR_EL0:
+		return pe->dlr;
+	case SYSTEM_DBG_DSPSR_EL0:
+		return pe->dspsr;
+	case SYSTEM_MPIDR:
+		/* clusters of four PEs */
+		return 0x80000000 | ((index / 4) << 8) | (index % 4);
+	case SYSTEM_CTR:
+		return ADISIM_CTR;
+	case SYSTEM_CLIDR:
+		/* no caches to maintain */
+		return 0;
+	default:
+		break;
+	}
+
+	struct adisim_sysreg *reg = adisim_sysreg_find(pe, key, false);
+	return reg ? reg->value : 0;
+}
+
+static void adisim_msr(struct adisim_pe *pe, uint16_t key, uint64_t value)
+{
+	switch (key) {
+	case SYSTEM_DBG_DBGDTR_EL0:
+		pe->dtrtx = value;
+		pe->dtrrx = value >> 32;
+		pe->txfull = true;
+		return;
+	case SYSTEM_DBG_DTRTX_EL0:
+		pe->dtrtx = value;
+		pe->txfull = true;
+		return;
+	case SYSTEM_DBG_DLR_EL0:
+		pe->dlr = value;
+		return;
+	case SYSTEM_DBG_DSPSR_EL0:
+		pe->dspsr = value;
+		return;
+	default:
+		break;
+	}
+
+	struct adisim_sysreg *reg = adisim_sysreg_find(pe, key, true);
+	if (reg)
+		reg->value = value;
+	else
+		LOG_DEBUG("adisim: no room for system register 0x%04" PRIx16, key);
+}
+
+static const uint16_t adisim_spsr_key[4] = {
+	0, SYSTEM_SPSR_EL1, SYSTEM_SPSR_EL2, SYSTEM_SPSR_EL3,
+};
+
+/* Execute one instruction written to EDITR, sets EDSCR.ERR on any fault */
+static void adisim_execute(struct adisim_pe *pe, uint32_t opcode)
+{
+	unsigned int rt = opcode & 0x1f;
+	unsigned int rn = (opcode >> 5) & 0x1f;
+
+	adisim.stats.instructions++;
+
+	if ((opcode & 0xfff00000) == 0xd5300000) {
+		/* MRS */
+		adisim_set_xreg(pe, rt, adisim_mrs(pe, (opcode >> 5) & 0xffff), false);
+	} else if ((opcode & 0xfff00000) == 0xd5100000) {
+		/* MSR (register) */
+		adisim_msr(pe, (opcode >> 5) & 0xffff, adisim_xreg(pe, rt, false));
+	} else if ((opcode & 0xfff00000) == 0xd5000000) {
+		/* barriers, hints, MSR (immediate) and cache maintenance */
+	} else if ((opcode & 0xffe0001c) == 0xd4a00000 && (opcode & 3)) {
+		/* DCPS<n> */
+		unsigned int el = opcode & 3;
+		if (el > pe->el) {
+			adisim_msr(pe, adisim_spsr_key[el], adisim_pstate(pe));
+			pe->el = el;
+		}
+	} else if (opcode == ARMV8_DRPS) {
+		if (pe->el == 0) {
+			pe->err = true;
+			return;
+		}
+		unsigned int el = (adisim_mrs(pe, adisim_spsr_key[pe->el]) >> 2) & 3;
+		pe->el = el < pe->el ? el : pe->el - 1;
+	} else if ((opcode & 0x7f800000) == 0x11000000) {
+		/* ADD (immediate), which includes MOV to and from SP */
+		uint64_t imm = ((opcode >> 10) & 0xfff) << ((opcode & (1 << 22)) ? 12 : 0);
+		uint64_t value = adisim_xreg(pe, rn, true) + imm;
+		if (!(opcode & 0x80000000))
+			value = (uint32_t)value;
+		adisim_set_xreg(pe, rt, value, true);
+	} else if ((opcode & 0x3fa00c00) == 0x38000400) {
+		/* LDR/STR (immediate, post-index) */
+		uint32_t size = 1 << (opcode >> 30);
+		int64_t imm = (int32_t)(opcode << 11) >> 23;
+		uint64_t address = adisim_xreg(pe, rn, true);
+		uint64_t value;
+
+		if (opcode & (1 << 22)) {
+			if (!adisim_mem_read(address, size, &value)) {
+				pe->err = true;
+				return;
+			}
+			adisim_set_xreg(pe, rt, value, false);
+		} else if (!adisim_mem_write(address, size, adisim_xreg(pe, rt, false))) {
+			pe->err = true;
+			return;
+		}
+		adisim_set_xreg(pe, rn, address + imm, true);
+	} else if ((opcode & 0xffeffc00) == 0x4e083c00) {
+		/* UMOV Xd, Vn.D[i] */
+		adisim_set_xreg(pe, rt, pe->v[rn][(opcode >> 20) & 1], false);
+	} else if ((opcode & 0xffeffc00) == 0x4e081c00) {
+		/* INS Vd.D[i], Xn */
+		pe->v[rt][(opcode >> 20) & 1] = adisim_xreg(pe, rn, false);
+	} else {
+		LOG_DEBUG("adisim: PE%u undefined instruction 0x%08" PRIx32,
+				(unsigned int)(pe - adisim.pes), opcode);
+		pe->err = true;
+	}
+}
+
+static void adisim_halt(struct adisim_pe *pe, uint32_t reason)
+{
+	if (pe->halted)
+		return;
+
+	pe->halted = true;
+	pe->reason = reason;
+	pe->dlr = pe->pc;
+	pe->dspsr = adisim_pstate(pe);
+	pe->itr_busy = 0;
+}
+
+static void adisim_restart(struct adisim_pe *pe)
+{
+	if (!pe->halted)
+		return;
+
+	pe->halted = false;
+	pe->sdr = true;
+	pe->pc = pe->dlr;
+	pe->el = (pe->dspsr >> 2) & 3;
+
+	if (pe->edecr & ADISIM_EDECR_SS) {
+		/* "execute" one instruction */
+		pe->pc += 4;
+		adisim_halt(pe, DSCRV8_ENTRY_HALT_STEP_NORMAL);
+	} else if (pe->cti.trout & CTI_TRIG(HALT)) {
+		/* the debug request is still asserted */
+		adisim_halt(pe, DSCRV8_ENTRY_EXT_DEBUG);
+	}
+}
+
+static void adisim_reset_pe(struct adisim_pe *pe)
+{
+	pe->halted = false;
+	pe->el = 3;
+	pe->pc = adisim.num_regions ? adisim.regions[0].base : 0;
+	pe->sp = 0;
+	memset(pe->x, 0, sizeof(pe->x));
+	memset(pe->v, 0, sizeof(pe->v));
+	pe->num_sysregs = 0;
+	pe->sr = true;
+}
+
+/*----------------------------------------------------------------------*/
+/* debug block and CTI registers */
+
+static uint32_t adisim_dscr(struct adisim_pe *pe)
+{
+	uint32_t dscr = (pe->dscr & ADISIM_DSCR_RW) | DSCR_EL_STATUS_MASK;
+
+	if (pe->halted) {
+		dscr |= pe->reason | (pe->el << 8);
+		if (pe->itr_busy)
+			pe->itr_busy--;
+		else
+			dscr |= DSCR_ITE;
+	} else {
+		dscr |= DSCRV8_ENTRY_NON_DEBUG;
+	}
+
+	if (pe->err)
+		dscr |= DSCR_ERR;
+	if (pe->txu)
+		dscr |= DSCR_TXU;
+	if (pe->rto)
+		dscr |= DSCR_RTO;
+	if (pe->ito)
+		dscr |= DSCR_ITO;
+	if (pe->txfull)
+		dscr |= DSCR_DTR_TX_FULL;
+	if (pe->rxfull)
+		dscr |= DSCR_DTR_RX_FULL;
+
+	return dscr;
+}
+
+/* CoreSight component and peripheral ID registers */
+static bool adisim_id_read(uint32_t offset, uint32_t devarch, uint32_t devtype,
+		uint32_t part, uint32_t *data)
+{
+	switch (offset) {
+	case 0xfbc:
+		*data = devarch;
+		return true;
+	case 0xfcc:
+		*data = devtype;
+		return true;
+	case 0xfd0:
+		*data = 0x04;	/* JEP106 continuation code of ARM */
+		return true;
+	case 0xfe0:
+		*data = part & 0xff;
+		return true;
+	case 0xfe4:
+		*data = ((part >> 8) & 0xf) | 0xb0;
+		return true;
+	case 0xfe8:
+		*data = 0x0b;
+		return true;
+	case 0xff0:
+		*data = 0x0d;
+		return true;
+	case 0xff4:
+		*data = 0x90;	/* class 9, CoreSight component */
+		return true;
+	case 0xff8:
+		*data = 0x05;
+		return true;
+	case 0xffc:
+		*data = 0xb1;
+		return true;
+	default:
+		break;
+	}
+
+	return false;
+}
+
+static bool adisim_rom_read(uint32_t offset, uint32_t *data)
+{
+	if (offset < 8 * adisim.num_pes) {
+		unsigned int n = offset / 8;
+		uint32_t base = (offset & 4) ? ADISIM_CTI_BASE(n) : ADISIM_DBG_BASE(n);
+		*data = (base - ADISIM_ROM_BASE) | 0x3;	/* present, 32-bit format */
+		return true;
+	}
+
+	if (offset < 0xf00) {
+		*data = 0;
+		return true;
+	}
+
+	if (offset == 0xfc8) {
+		*data = 0;	/* DEVID: 32-bit entries, no power requests */
+		return true;
+	}
+
+	return adisim_id_read(offset, 0x47700af7, 0, 0x4c7, data);
+}
+
+static bool adisim_dbg_read(struct adisim_pe *pe, uint32_t offset, uint32_t *data)
+{
+	if (offset >= CPUV8_DBG_BVR_BASE && offset < CPUV8_DBG_BVR_BASE + 16 * ADISIM_NUM_BRP) {
+		unsigned int n = (offset - CPUV8_DBG_BVR_BASE) / 16;
+		switch (offset & 0xf) {
+		case 0x0:
+		case 0x4:
+			*data = pe->bvr[n][(offset >> 2) & 1];
+			return true;
+		case 0x8:
+			*data = pe->bcr[n];
+			return true;
+		}
+		return false;
+	}
+
+	if (offset >= CPUV8_DBG_WVR_BASE && offset < CPUV8_DBG_WVR_BASE + 16 * ADISIM_NUM_WRP) {
+		unsigned int n = (offset - CPUV8_DBG_WVR_BASE) / 16;
+		switch (offset & 0xf) {
+		case 0x0:
+		case 0x4:
+			*data = pe->wvr[n][(offset >> 2) & 1];
+			return true;
+		case 0x8:
+			*data = pe->wcr[n];
+			return true;
+		}
+		return false;
+	}
+
+	switch (offset) {
+	case CPUV8_DBG_EDESR:
+	case CPUV8_DBG_WFAR0:
+	case CPUV8_DBG_WFAR1:
+	case CPUV8_DBG_PRCR:
+	case CPUV8_DBG_LOCKSTATUS:
+	case CPUV8_DBG_MEMFEATURE0 + 4:
+	case CPUV8_DBG_DBGFEATURE0 + 4:
+	case CPUV8_DBG_CPUFEATURE0 + 4:
+		*data = 0;
+		break;
+	case CPUV8_DBG_EDECR:
+		*data = pe->edecr;
+		break;
+	case CPUV8_DBG_DTRRX:
+		*data = pe->dtrrx;
+		break;
+	case CPUV8_DBG_DSCR:
+		*data = adisim_dscr(pe);
+		break;
+	case CPUV8_DBG_DTRTX:
+		*data = pe->dtrtx;
+		if (!pe->txfull) {
+			pe->txu = true;
+		} else {
+			pe->txfull = false;
+			/* memory access mode: reissue LDR W1, [X0], #4; MSR DBGDTRTX_EL0, X1 */
+			if ((pe->dscr & DSCR_MA) && pe->halted && !pe->err) {
+				adisim_execute(pe, ARMV8_LDRW_IP(1, 0));
+				if (!pe->err)
+					adisim_execute(pe, ARMV8_MSR_GP(SYSTEM_DBG_DTRTX_EL0, 1));
+			}
+		}
+		break;
+	case CPUV8_DBG_EDPCSR:
+		*data = pe->halted ? 0xffffffff : (uint32_t)pe->pc;
+		break;
+	case CPUV8_DBG_EDPCSR + 0xc:
+		*data = pe->halted ? 0xffffffff : (uint32_t)(pe->pc >> 32);
+		break;
+	case CPUV8_DBG_PRSR:
+		*data = PRSR_PU;
+		if (pe->halted)
+			*data |= PRSR_HALT;
+		if (pe->oslk)
+			*data |= PRSR_OSLK;
+		if (pe->sr)
+			*data |= PRSR_SR;
+		if (pe->sdr)
+			*data |= PRSR_SDR;
+		pe->sr = false;
+		pe->sdr = false;
+		break;
+	case CPUV8_DBG_MAINID0:
+		*data = ADISIM_MIDR;
+		break;
+	case CPUV8_DBG_CPUFEATURE0:
+		*data = 0x00002222;	/* EL0-EL3 in AArch64 */
+		break;
+	case CPUV8_DBG_DBGFEATURE0:
+		*data = ADISIM_DFR0;
+		break;
+	case CPUV8_DBG_MEMFEATURE0:
+		*data = ADISIM_MMFR0;
+		break;
+	case CPUV8_DBG_AUTHSTATUS:
+		*data = 0xff;
+		break;
+	case CPUV8_DBG_EDDEVID:
+		*data = 0x3;	/* EDPCSR, EDCIDSR and EDVIDSR */
+		break;
+	default:
+		return adisim_id_read(offset, 0x47706a15, 0x15, ADISIM_DBG_PART, data);
+	}
+
+	return true;
+}
+
+static bool adisim_dbg_write(struct adisim_pe *pe, uint32_t offset, uint32_t data)
+{
+	if (offset >= CPUV8_DBG_BVR_BASE && offset < CPUV8_DBG_BVR_BASE + 16 * ADISIM_NUM_BRP) {
+		unsigned int n = (offset - CPUV8_DBG_BVR_BASE) / 16;
+		switch (offset & 0xf) {
+		case 0x0:
+		case 0x4:
+			pe->bvr[n][(offset >> 2) & 1] = data;
+			return true;
+		case 0x8:
+			pe->bcr[n] = data;
+			return true;
+		}
+		return false;
+	}
+
+	if (offset >= CPUV8_DBG_WVR_BASE && offset < CPUV8_DBG_WVR_BASE + 16 * ADISIM_NUM_WRP) {
+		unsigned int n = (offset - CPUV8_DBG_WVR_BASE) / 16;
+		switch (offset & 0xf) {
+		case 0x0:
+		case 0x4:
+			pe->wvr[n][(offset >> 2) & 1] = data;
+			return true;
+		case 0x8:
+			pe->wcr[n] = data;
+			return true;
+		}
+		return false;
+	}
+
+	switch (offset) {
+	case CPUV8_DBG_EDECR:
+		pe->edecr = data;
+		break;
+	case CPUV8_DBG_DTRRX:
+		pe->dtrrx = data;
+		pe->rxfull = true;
+		/* memory access mode: issue MRS X1, DBGDTRRX_EL0; STR W1, [X0], #4 */
+		if ((pe->dscr & DSCR_MA) && pe->halted && !pe->err) {
+			adisim_execute(pe, ARMV8_MRS(SYSTEM_DBG_DTRRX_EL0, 1));
+			adisim_execute(pe, ARMV8_STRW_IP(1, 0));
+		}
+		break;
+	case CPUV8_DBG_ITR:
+		if (!pe->halted || pe->err || (pe->dscr & DSCR_MA))
+			break;
+		if (pe->itr_busy) {
+			/* the previous instruction has not completed */
+			pe->ito = true;
+			break;
+		}
+		adisim_execute(pe, data);
+		pe->itr_busy = adisim.itr_latency;
+		break;
+	case CPUV8_DBG_DSCR:
+		pe->dscr = data & ADISIM_DSCR_RW;
+		break;
+	case CPUV8_DBG_DTRTX:
+		pe->dtrtx = data;
+		break;
+	case CPUV8_DBG_DRCR:
+		if (data & DRCR_CSE) {
+			pe->err = false;
+			pe->txu = false;
+			pe->rto = false;
+			pe->ito = false;
+		}
+		break;
+	case CPUV8_DBG_OSLAR:
+		pe->oslk = data & 1;
+		break;
+	case CPUV8_DBG_EDESR:
+	case CPUV8_DBG_PRCR:
+	case CPUV8_DBG_LOCKACCESS:
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static void adisim_cti_trigger(struct adisim_pe *pe, unsigned int trigger)
+{
+	switch (trigger) {
+	case CTI_TRIG_HALT:
+		/* debug request is held until acknowledged through CTIINTACK */
+		pe->cti.trout |= CTI_TRIG(HALT);
+		adisim_halt(pe, DSCRV8_ENTRY_EXT_DEBUG);
+		break;
+	case CTI_TRIG_RESUME:
+		adisim_restart(pe);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Deliver channel events raised at one CTI, and through the CTM to all
+ * others. CTIGATE gates both directions between a CTI and the CTM.
+ */
+static void adisim_cti_event(struct adisim_pe *src, uint32_t channels)
+{
+	uint32_t ctm = channels & src->cti.gate;
+
+	for (unsigned int i = 0; i < adisim.num_pes; i++) {
+		struct adisim_pe *pe = &adisim.pes[i];
+		uint32_t events = (pe == src) ? channels : ctm & pe->cti.gate;
+
+		if (!events || !(pe->cti.ctrl & 1))
+			continue;
+
+		for (unsigned int t = 0; t < ARRAY_SIZE(pe->cti.outen); t++) {
+			if (pe->cti.outen[t] & events)
+				adisim_cti_trigger(pe, t);
+		}
+	}
+}
+
+static bool adisim_cti_read(struct adisim_pe *pe, uint32_t offset, uint32_t *data)
+{
+	struct adisim_cti *cti = &pe->cti;
+
+	if (offset >= CTI_INEN0 && offset < CTI_INEN0 + sizeof(cti->inen)) {
+		*data = cti->inen[(offset - CTI_INEN0) / 4];
+		return true;
+	}
+
+	if (offset >= CTI_OUTEN0 && offset < CTI_OUTEN0 + sizeof(cti->outen)) {
+		*data = cti->outen[(offset - CTI_OUTEN0) / 4];
+		return true;
+	}
+
+	switch (offset) {
+	case CTI_CTR:
+		*data = cti->ctrl;
+		break;
+	case CTI_TROUT_STATUS:
+		*data = cti->trout;
+		break;
+	case CTI_CHOU_STATUS:
+		*data = cti->appset;
+		break;
+	case CTI_GATE:
+		*data = cti->gate;
+		break;
+	case CTI_TRIN_STATUS:
+	case CTI_CHIN_STATUS:
+		*data = 0;
+		break;
+	default:
+		return adisim_id_read(offset, 0x47701a14, 0x14, ADISIM_CTI_PART, data);
+	}
+
+	return true;
+}
+
+static bool adisim_cti_write(struct adisim_pe *pe, uint32_t offset, uint32_t data)
+{
+	struct adisim_cti *cti = &pe->cti;
+
+	if (offset >= CTI_INEN0 && offset < CTI_INEN0 + sizeof(cti->inen)) {
+		cti->inen[(offset - CTI_INEN0) / 4] = data & 0xf;
+		return true;
+	}
+
+	if (offset >= CTI_OUTEN0 && offset < CTI_OUTEN0 + sizeof(cti->outen)) {
+		cti->outen[(offset - CTI_OUTEN0) / 4] = data & 0xf;
+		return true;
+	}
+
+	switch (offset) {
+	case CTI_CTR:
+		cti->ctrl = data & 1;
+		break;
+	case CTI_INACK:
+		cti->trout &= ~data;
+		break;
+	case CTI_APPSET:
+		cti->appset |= data & 0xf;
+		adisim_cti_event(pe, data & 0xf);
+		break;
+	case CTI_APPCLEAR:
+		cti->appset &= ~data;
+		break;
+	case CTI_APPPULSE:
+		adisim_cti_event(pe, data & 0xf);
+		break;
+	case CTI_GATE:
+		cti->gate = data & 0xf;
+		break;
+	case CTI_UNLOCK:
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/*----------------------------------------------------------------------*/
+/* MEM-APs */
+
+static bool adisim_apb_access(uint64_t address, bool write, uint32_t *data)
+{
+	uint32_t offset = address & 0xfff;
+
+	if (address < ADISIM_ROM_BASE + 0x1000)
+		return write ? false : adisim_rom_read(offset, data);
+
+	if (address < ADISIM_PE_BASE)
+		return false;
+
+	uint64_t n = (address - ADISIM_PE_BASE) / ADISIM_PE_STRIDE;
+	uint64_t block = (address - ADISIM_PE_BASE) % ADISIM_PE_STRIDE;
+
+	if (n >= adisim.num_pes)
+		return false;
+
+	struct adisim_pe *pe = &adisim.pes[n];
+
+	if (block < 0x1000)
+		return write ? adisim_dbg_write(pe, offset, *data) : adisim_dbg_read(pe, offset, data);
+
+	if (block >= ADISIM_CTI_OFFSET && block < ADISIM_CTI_OFFSET + 0x1000)
+		return write ? adisim_cti_write(pe, offset, *data) : adisim_cti_read(pe, offset, data);
+
+	return false;
+}
+
+/* One data phase on DRW or BDx, "data" holds the 32-bit lane image */
+static bool adisim_ap_data(struct adisim_ap *ap, uint64_t address, bool write,
+		bool increment, uint32_t *data)
+{
+	uint32_t size = 1 << (ap->csw & CSW_SIZE_MASK);
+	unsigned int beats = 1;
+
+	if (ap == &adisim.aps[ADISIM_APB_AP]) {
+		if (size != 4 || (address & 3))
+			return false;
+		return adisim_apb_access(address, write, data);
+	}
+
+	if (size > 4)
+		return false;
+	if ((ap->csw & CSW_ADDRINC_MASK) == CSW_ADDRINC_PACKED && increment)
+		beats = 4 / size;
+
+	if (!write)
+		*data = 0;
+
+	for (unsigned int i = 0; i < beats; i++) {
+		unsigned int lane = (address & 3) * 8;
+		uint64_t value;
+
+		if (write) {
+			if (!adisim_mem_write(address, size, *data >> lane))
+				return false;
+		} else {
+			if (!adisim_mem_read(address, size, &value))
+				return false;
+			*data |= value << lane;
+		}
+
+		if (increment)
+			ap->tar = address += size;
+	}
+
+	return true;
+}
+
+static bool adisim_ap_access(unsigned int ap_num, unsigned int reg, bool write, uint32_t *data)
+{
+	/* an AP that does not exist reads as zero */
+	if (ap_num >= ARRAY_SIZE(adisim.aps)) {
+		if (!write)
+			*data = 0;
+		return true;
+	}
+
+	struct adisim_ap *ap = &adisim.aps[ap_num];
+
+	/* ADIv5 register offsets map onto the ADIv6 MEM-AP register block */
+	if (reg < 0x100)
+		reg |= MEM_AP_REG_CSW;
+
+	switch (reg) {
+	case MEM_AP_REG_CSW:
+		if (write) {
+			ap->csw = *data;
+			/* APB-AP does 32-bit accesses only */
+			if (ap_num == ADISIM_APB_AP) {
+				ap->csw = (ap->csw & ~CSW_SIZE_MASK) | CSW_32BIT;
+				if ((ap->csw & CSW_ADDRINC_MASK) == CSW_ADDRINC_PACKED)
+					ap->csw &= ~CSW_ADDRINC_MASK;
+			}
+		} else {
+			*data = ap->csw | CSW_DEVICE_EN;
+		}
+		return true;
+	case MEM_AP_REG_TAR:
+		if (write)
+			ap->tar = (ap->tar & ~0xffffffffull) | *data;
+		else
+			*data = ap->tar;
+		return true;
+	case MEM_AP_REG_TAR_UPPER:
+		if (write)
+			ap->tar = (ap->tar & 0xffffffffull) | (uint64_t)*data << 32;
+		else
+			*data = ap->tar >> 32;
+		return true;
+	case MEM_AP_REG_DRW:
+		return adisim_ap_data(ap, ap->tar, write,
+				(ap->csw & CSW_ADDRINC_MASK) != CSW_ADDRINC_OFF, data);
+	case MEM_AP_REG_BD0:
+	case MEM_AP_REG_BD1:
+	case MEM_AP_REG_BD2:
+	case MEM_AP_REG_BD3:
+		return adisim_ap_data(ap, (ap->tar & ~0xfull) | (reg & 0xc), write, false, data);
+	case MEM_AP_REG_CFG:
+		if (!write)
+			*data = ap->cfg;
+		return true;
+	case MEM_AP_REG_BASE:
+		if (!write)
+			*data = ap->base;
+		return true;
+	case MEM_AP_REG_BASE_UPPER:
+		if (!write)
+			*data = 0;
+		return true;
+	case AP_REG_IDR:
+		if (!write)
+			*data = ap->idr;
+		return true;
+	default:
+		break;
+	}
+
+	return false;
+}
+
+/*----------------------------------------------------------------------*/
+/* DP operations */
+
+static uint32_t adisim_random(void)
+{
+	/* xorshift32, fixed seed so that runs are repeatable */
+	adisim.rand ^= adisim.rand << 13;
+	adisim.rand ^= adisim.rand >> 17;
+	adisim.rand ^= adisim.rand << 5;
+	return adisim.rand;
+}
+
+static void adisim_transfer(void)
+{
+	adisim.pending++;
+	adisim.stats.transfers++;
+
+	/* each WAIT costs a retry of the transfer */
+	while (adisim.wait_percent && adisim_random() % 100 < adisim.wait_percent) {
+		adisim.pending++;
+		adisim.stats.transfers++;
+		adisim.stats.waits++;
+	}
+}
+
+static int adisim_connect(struct adi_dap *dap)
+{
+	int retval;
+
+	LOG_INFO("adisim: %u PEs, APB-AP #%d, AXI-AP #%d", adisim.num_pes,
+			ADISIM_APB_AP, ADISIM_AXI_AP);
+
+	dap->do_reconnect = false;
+	dap_invalidate_cache(dap);
+
+	retval = dap_dp_init(dap);
+	if (retval != ERROR_OK)
+		dap->do_reconnect = true;
+
+	return retval;
+}
+
+static int adisim_send_sequence(struct adi_dap *dap, enum swd_special_seq seq)
+{
+	return ERROR_OK;
+}
+
+static int adisim_queue_dp_read(struct adi_dap *dap, unsigned int reg, uint32_t *data)
+{
+	uint32_t value;
+
+	adisim_transfer();
+
+	switch (reg) {
+	case DP_DPIDR:
+		value = ADISIM_DPIDR;
+		break;
+	case DP_DPIDR1:
+		value = ADISIM_DPIDR1;
+		break;
+	case DP_BASEPTR0:
+		value = ADISIM_ROM_BASE | 1;
+		break;
+	case DP_CTRL_STAT:
+		value = adisim.ctrl_stat;
+		/* power domains come up as soon as requested */
+		if (value & CDBGPWRUPREQ)
+			value |= CDBGPWRUPACK;
+		if (value & CSYSPWRUPREQ)
+			value |= CSYSPWRUPACK;
+		break;
+	case DP_SELECT:
+		value = adisim.select;
+		break;
+	default:
+		value = 0;
+		break;
+	}
+
+	if (data)
+		*data = value;
+
+	return ERROR_OK;
+}
+
+static int adisim_queue_dp_write(struct adi_dap *dap, unsigned int reg, uint32_t data)
+{
+	adisim_transfer();
+
+	switch (reg) {
+	case DP_ABORT:
+		if (data & STKERRCLR)
+			adisim.ctrl_stat &= ~SSTICKYERR;
+		if (data & ORUNERRCLR)
+			adisim.ctrl_stat &= ~SSTICKYORUN;
+		break;
+	case DP_CTRL_STAT:
+		/* writing one to the sticky flags clears them, as over JTAG */
+		adisim.ctrl_stat = (adisim.ctrl_stat & ~data & (SSTICKYERR | SSTICKYORUN))
+				| (data & (CDBGPWRUPREQ | CSYSPWRUPREQ | CORUNDETECT));
+		break;
+	case DP_SELECT:
+		adisim.select = data;
+		break;
+	default:
+		break;
+	}
+
+	return ERROR_OK;
+}
+
+static int adisim_queue_ap_access(struct adi_ap *ap, unsigned int reg, bool write, uint32_t *data)
+{
+	adisim_transfer();
+
+	/* after a fault the rest of the batch is discarded */
+	if (adisim.ctrl_stat & SSTICKYERR) {
+		if (!write)
+			*data = 0;
+		return ERROR_OK;
+	}
+
+	if (!adisim_ap_access(ap->ap_num, reg, write, data)) {
+		LOG_DEBUG("adisim: AP #%d %s fault, reg 0x%03x TAR 0x%016" PRIx64,
+				ap->ap_num, write ? "write" : "read", reg,
+				ap->ap_num < ARRAY_SIZE(adisim.aps) ? adisim.aps[ap->ap_num].tar : 0);
+		adisim.ctrl_stat |= SSTICKYERR;
+		adisim.fault = true;
+		adisim.stats.faults++;
+		if (!write)
+			*data = 0;
+	}
+
+	return ERROR_OK;
+}
+
+static int adisim_queue_ap_read(struct adi_ap *ap, unsigned int reg, uint32_t *data)
+{
+	uint32_t dummy;
+
+	return adisim_queue_ap_access(ap, reg, false, data ? data : &dummy);
+}
+
+static int adisim_queue_ap_write(struct adi_ap *ap, unsigned int reg, uint32_t data)
+{
+	return adisim_queue_ap_access(ap, reg, true, &data);
+}
+
+static int adisim_queue_ap_abort(struct adi_dap *dap, uint8_t *ack)
+{
+	adisim_transfer();
+	adisim.ctrl_stat &= ~SSTICKYERR;
+	return ERROR_OK;
+}
+
+static int adisim_run(struct adi_dap *dap)
+{
+	uint64_t us;
+	int retval = ERROR_OK;
+
+	if (!adisim.pending)
+		return ERROR_OK;
+
+	us = adisim.latency_us;
+	if (adisim.khz > 0)
+		us += (uint64_t)adisim.pending * ADISIM_XFER_CLOCKS * 1000 / adisim.khz;
+
+	adisim.stats.runs++;
+	adisim.stats.wait_us += us;
+	adisim.pending = 0;
+
+	if (us)
+		jtag_sleep(us);
+
+	/* report the fault and clear it again, as an adapter would */
+	if (adisim.fault) {
+		adisim.fault = false;
+		adisim.ctrl_stat &= ~SSTICKYERR;
+		retval = ERROR_FAIL;
+	}
+
+	return retval;
+}
+
+static void adisim_quit(struct adi_dap *dap)
+{
+}
+
+static const struct dp_ops adisim_dp_ops = {
+	.connect = adisim_connect,
+	.send_sequence = adisim_send_sequence,
+	.queue_dp_read = adisim_queue_dp_read,
+	.queue_dp_write = adisim_queue_dp_write,
+	.queue_ap_read = adisim_queue_ap_read,
+	.queue_ap_write = adisim_queue_ap_write,
+	.queue_ap_abort = adisim_queue_ap_abort,
+	.run = adisim_run,
+	.quit = adisim_quit,
+};
+
+/*----------------------------------------------------------------------*/
+/* adapter */
+
+static int adisim_init(void)
+{
+	if (!adisim.num_regions) {
+		adisim.regions[0].base = 0x80000000;
+		adisim.regions[0].size = 16 * 1024 * 1024;
+		adisim.num_regions = 1;
+	}
+
+	for (unsigned int i = 0; i < adisim.num_regions; i++) {
+		struct adisim_region *r = &adisim.regions[i];
+
+		r->data = calloc(1, r->size);
+		if (!r->data) {
+			LOG_ERROR("adisim: can't allocate %" PRIu64 " bytes of memory", r->size);
+			return ERROR_FAIL;
+		}
+		LOG_INFO("adisim: memory 0x%016" PRIx64 "-0x%016" PRIx64,
+				r->base, r->base + r->size - 1);
+	}
+
+	adisim.pes = calloc(adisim.num_pes, sizeof(*adisim.pes));
+	if (!adisim.pes)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < adisim.num_pes; i++) {
+		adisim_reset_pe(&adisim.pes[i]);
+		adisim.pes[i].oslk = true;
+		adisim.pes[i].cti.gate = 0xf;
+	}
+
+	adisim.aps[ADISIM_APB_AP] = (struct adisim_ap) {
+		.idr = ADISIM_APB_IDR,
+		.base = ADISIM_ROM_BASE | 0x3,
+		.csw = CSW_32BIT,
+	};
+	adisim.aps[ADISIM_AXI_AP] = (struct adisim_ap) {
+		.idr = ADISIM_AXI_IDR,
+		.cfg = 0x2,	/* large physical address */
+		.base = 0x2,	/* no debug entries */
+		.csw = CSW_32BIT,
+	};
+
+	return ERROR_OK;
+}
+
+static int adisim_quit_adapter(void)
+{
+	for (unsigned int i = 0; i < adisim.num_regions; i++) {
+		free(adisim.regions[i].data);
+		adisim.regions[i].data = NULL;
+	}
+
+	free(adisim.pes);
+	adisim.pes = NULL;
+
+	return ERROR_OK;
+}
+
+static int adisim_reset(int req_trst, int req_srst)
+{
+	if (!adisim.pes)
+		return ERROR_OK;
+
+	/* warm reset of the PEs, the debug domain keeps its state */
+	if (adisim.srst && !req_srst) {
+		for (unsigned int i = 0; i < adisim.num_pes; i++) {
+			struct adisim_pe *pe = &adisim.pes[i];
+
+			adisim_reset_pe(pe);
+			if (pe->edecr & ADISIM_EDECR_RCE)
+				adisim_halt(pe, DSCRV8_ENTRY_RESET_CATCH);
+		}
+	}
+	adisim.srst = req_srst;
+
+	return ERROR_OK;
+}
+
+static int adisim_speed(int speed)
+{
+	adisim.khz = speed;
+	return ERROR_OK;
+}
+
+static int adisim_khz(int khz, int *jtag_speed)
+{
+	*jtag_speed = khz;
+	return ERROR_OK;
+}
+
+static int adisim_speed_div(int speed, int *khz)
+{
+	*khz = speed;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(adisim_handle_cores_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int cores;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], cores);
+	if (cores < 1 || cores > ADISIM_MAX_CORES) {
+		command_print(CMD, "number of PEs must be 1..%d", ADISIM_MAX_CORES);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	adisim.num_pes = cores;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(adisim_handle_memory_command)
+{
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (adisim.num_regions == ADISIM_MAX_REGIONS) {
+		command_print(CMD, "too many memory regions");
+		return ERROR_FAIL;
+	}
+
+	uint64_t base, size;
+	COMMAND_PARSE_NUMBER(u64, CMD_ARGV[0], base);
+	COMMAND_PARSE_NUMBER(u64, CMD_ARGV[1], size);
+	if (!size || base + size - 1 < base) {
+		command_print(CMD, "invalid memory region");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	adisim.regions[adisim.num_regions].base = base;
+	adisim.regions[adisim.num_regions].size = size;
+	adisim.num_regions++;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(adisim_handle_latency_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], adisim.latency_us);
+
+	command_print(CMD, "adisim latency: %u us", adisim.latency_us);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(adisim_handle_wait_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int percent;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], percent);
+		if (percent > 99) {
+			command_print(CMD, "WAIT rate must be 0..99 percent");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		adisim.wait_percent = percent;
+	}
+
+	command_print(CMD, "adisim WAIT rate: %u%%", adisim.wait_percent);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(adisim_handle_itr_latency_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], adisim.itr_latency);
+
+	command_print(CMD, "adisim ITR latency: %u EDSCR reads", adisim.itr_latency);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(adisim_handle_stats_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		memset(&adisim.stats, 0, sizeof(adisim.stats));
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "runs:          %" PRIu64, adisim.stats.runs);
+	command_print(CMD, "transfers:     %" PRIu64, adisim.stats.transfers);
+	command_print(CMD, "WAITs:         %" PRIu64, adisim.stats.waits);
+	command_print(CMD, "faults:        %" PRIu64, adisim.stats.faults);
+	command_print(CMD, "instructions:  %" PRIu64, adisim.stats.instructions);
+	command_print(CMD, "link time:     %" PRIu64 " us", adisim.stats.wait_us);
+	return ERROR_OK;
+}
+
+static const struct command_registration adisim_subcommand_handlers[] = {
+	{
+		.name = "cores",
+		.handler = adisim_handle_cores_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set the number of simulated ARMv8 PEs",
+		.usage = "count",
+	},
+	{
+		.name = "memory",
+		.handler = adisim_handle_memory_command,
+		.mode = COMMAND_CONFIG,
+		.help = "add a RAM region to the simulated system",
+		.usage = "base size",
+	},
+	{
+		.name = "latency",
+		.handler = adisim_handle_latency_command,
+		.mode = COMMAND_ANY,
+		.help = "set the round trip latency of each queue run",
+		.usage = "[microseconds]",
+	},
+	{
+		.name = "wait",
+		.handler = adisim_handle_wait_command,
+		.mode = COMMAND_ANY,
+		.help = "set the percentage of transfers answered with WAIT",
+		.usage = "[percent]",
+	},
+	{
+		.name = "itr_latency",
+		.handler = adisim_handle_itr_latency_command,
+		.mode = COMMAND_ANY,
+		.help = "set the number of EDSCR reads an instruction stays in flight",
+		.usage = "[reads]",
+	},
+	{
+		.name = "stats",
+		.handler = adisim_handle_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show or reset the link statistics",
+		.usage = "['reset']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration adisim_command_handlers[] = {
+	{
+		.name = "adisim",
+		.mode = COMMAND_ANY,
+		.help = "simulated ADIv6 DAP and ARMv8 PEs",
+		.chain = adisim_subcommand_handlers,
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const char *const adisim_transports[] = { "dapdirect_swd", NULL };
+
+struct adapter_driver adisim_adapter_driver = {
+	.name = "adisim",
+	.transports = adisim_transports,
+	.commands = adisim_command_handlers,
+
+	.init = adisim_init,
+	.quit = adisim_quit_adapter,
+	.reset = adisim_reset,
+	.speed = adisim_speed,
+	.khz = adisim_khz,
+	.speed_div = adisim_speed_div,
+
+	.dap_swd_ops = &adisim_dp_ops,
+};
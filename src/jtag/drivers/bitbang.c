@@ -166,11 +166,16 @@ static int bitbang_runtest(int num_cycles)
 	}
 
 	/* execute num_cycles */
-	for (i = 0; i < num_cycles; i++) {
-		if (bitbang_interface->write(0, 0, 0) != ERROR_OK)
-			return ERROR_FAIL;
-		if (bitbang_interface->write(1, 0, 0) != ERROR_OK)
+	if (bitbang_interface->shift && num_cycles > 0) {
+		if (bitbang_interface->shift(NULL, NULL, NULL, num_cycles) != ERROR_OK)
 			return ERROR_FAIL;
+	} else {
+		for (i = 0; i < num_cycles; i++) {
+			if (bitbang_interface->write(0, 0, 0) != ERROR_OK)
+				return ERROR_FAIL;
+			if (bitbang_interface->write(1, 0, 0) != ERROR_OK)
+				return ERROR_FAIL;
+		}
 	}
 	if (bitbang_interface->write(CLOCK_IDLE(), 0, 0) != ERROR_OK)
 		return ERROR_FAIL;
@@ -219,62 +224,77 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		bitbang_end_state(saved_end_state);
 	}
 
-	size_t buffered = 0;
-	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
-		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
-		int tdi;
-		int bytec = bit_cnt/8;
-		int bcval = 1 << (bit_cnt % 8);
-
-		/* if we're just reading the scan, but don't care about the output
-		 * default to outputting 'low', this also makes valgrind traces more readable,
-		 * as it removes the dependency on an uninitialised value
-		 */
-		tdi = 0;
-		if ((type != SCAN_IN) && (buffer[bytec] & bcval))
-			tdi = 1;
-
-		if (bitbang_interface->write(0, tms, tdi) != ERROR_OK)
+	if (bitbang_interface->shift) {
+		/* TMS is only set on the last bit, to leave the shift state */
+		uint8_t *tms = calloc(DIV_ROUND_UP(scan_size, 8), 1);
+		if (tms == NULL)
 			return ERROR_FAIL;
+		tms[(scan_size - 1) / 8] = 1 << ((scan_size - 1) % 8);
 
-		if (type != SCAN_OUT) {
-			if (bitbang_interface->buf_size) {
-				if (bitbang_interface->sample() != ERROR_OK)
-					return ERROR_FAIL;
-				buffered++;
-			} else {
-				switch (bitbang_interface->read()) {
-					case BB_LOW:
-						buffer[bytec] &= ~bcval;
-						break;
-					case BB_HIGH:
-						buffer[bytec] |= bcval;
-						break;
-					default:
+		int retval = bitbang_interface->shift(tms,
+				type != SCAN_IN ? buffer : NULL,
+				type != SCAN_OUT ? buffer : NULL, scan_size);
+		free(tms);
+		if (retval != ERROR_OK)
+			return ERROR_FAIL;
+	} else {
+		size_t buffered = 0;
+		for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
+			int tms = (bit_cnt == scan_size-1) ? 1 : 0;
+			int tdi;
+			int bytec = bit_cnt/8;
+			int bcval = 1 << (bit_cnt % 8);
+
+			/* if we're just reading the scan, but don't care about the output
+			 * default to outputting 'low', this also makes valgrind traces more readable,
+			 * as it removes the dependency on an uninitialised value
+			 */
+			tdi = 0;
+			if ((type != SCAN_IN) && (buffer[bytec] & bcval))
+				tdi = 1;
+
+			if (bitbang_interface->write(0, tms, tdi) != ERROR_OK)
+				return ERROR_FAIL;
+
+			if (type != SCAN_OUT) {
+				if (bitbang_interface->buf_size) {
+					if (bitbang_interface->sample() != ERROR_OK)
 						return ERROR_FAIL;
+					buffered++;
+				} else {
+					switch (bitbang_interface->read()) {
+						case BB_LOW:
+							buffer[bytec] &= ~bcval;
+							break;
+						case BB_HIGH:
+							buffer[bytec] |= bcval;
+							break;
+						default:
+							return ERROR_FAIL;
+					}
 				}
 			}
-		}
-
-		if (bitbang_interface->write(1, tms, tdi) != ERROR_OK)
-			return ERROR_FAIL;
 
-		if (type != SCAN_OUT && bitbang_interface->buf_size &&
-				(buffered == bitbang_interface->buf_size ||
-				 bit_cnt == scan_size - 1)) {
-			for (unsigned i = bit_cnt + 1 - buffered; i <= bit_cnt; i++) {
-				switch (bitbang_interface->read_sample()) {
-					case BB_LOW:
-						buffer[i/8] &= ~(1 << (i % 8));
-						break;
-					case BB_HIGH:
-						buffer[i/8] |= 1 << (i % 8);
-						break;
-					default:
-						return ERROR_FAIL;
+			if (bitbang_interface->write(1, tms, tdi) != ERROR_OK)
+				return ERROR_FAIL;
+
+			if (type != SCAN_OUT && bitbang_interface->buf_size &&
+					(buffered == bitbang_interface->buf_size ||
+					 bit_cnt == scan_size - 1)) {
+				for (unsigned i = bit_cnt + 1 - buffered; i <= bit_cnt; i++) {
+					switch (bitbang_interface->read_sample()) {
+						case BB_LOW:
+							buffer[i/8] &= ~(1 << (i % 8));
+							break;
+						case BB_HIGH:
+							buffer[i/8] |= 1 << (i % 8);
+							break;
+						default:
+							return ERROR_FAIL;
+					}
 				}
+				buffered = 0;
 			}
-			buffered = 0;
 		}
 	}
 
@@ -289,6 +309,60 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 	return ERROR_OK;
 }
 
+/* Scans whose TDO is stored by the interface's flush() */
+struct bitbang_pending_scan {
+	struct scan_command *scan;
+	uint8_t *buffer;
+};
+
+static struct bitbang_pending_scan *bitbang_pending;
+static unsigned int bitbang_num_pending;
+static unsigned int bitbang_max_pending;
+
+static int bitbang_add_pending(struct scan_command *scan, uint8_t *buffer)
+{
+	if (bitbang_num_pending == bitbang_max_pending) {
+		unsigned int max = bitbang_max_pending ? 2 * bitbang_max_pending : 64;
+		struct bitbang_pending_scan *pending = realloc(bitbang_pending,
+				max * sizeof(*pending));
+		if (pending == NULL)
+			return ERROR_FAIL;
+		bitbang_pending = pending;
+		bitbang_max_pending = max;
+	}
+
+	bitbang_pending[bitbang_num_pending].scan = scan;
+	bitbang_pending[bitbang_num_pending].buffer = buffer;
+	bitbang_num_pending++;
+	return ERROR_OK;
+}
+
+/* Send everything shifted so far, collect the TDO of the pending scans and
+ * hand it to the scan fields; or just drop the pending scans. */
+static int bitbang_complete_pending(bool discard)
+{
+	int retval = ERROR_OK;
+
+	if (!bitbang_interface->shift)
+		return ERROR_OK;
+
+	/* even when discarding, the driver must forget the TDO buffers */
+	if (bitbang_interface->flush(discard) != ERROR_OK && !discard) {
+		discard = true;
+		retval = ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < bitbang_num_pending; i++) {
+		if (!discard && jtag_read_buffer(bitbang_pending[i].buffer,
+				bitbang_pending[i].scan) != ERROR_OK)
+			retval = ERROR_JTAG_QUEUE_FAILED;
+		free(bitbang_pending[i].buffer);
+	}
+	bitbang_num_pending = 0;
+
+	return retval;
+}
+
 int bitbang_execute_queue(void)
 {
 	struct jtag_command *cmd = jtag_command_queue;	/* currently processed command */
@@ -307,6 +381,10 @@ int bitbang_execute_queue(void)
 	 */
 	retval = ERROR_OK;
 
+	/* drop what a previous queue left behind when it failed */
+	if (bitbang_num_pending)
+		bitbang_complete_pending(true);
+
 	if (bitbang_interface->blink) {
 		if (bitbang_interface->blink(1) != ERROR_OK)
 			return ERROR_FAIL;
@@ -354,14 +432,31 @@ int bitbang_execute_queue(void)
 					tap_state_name(cmd->cmd.scan->end_state));
 				type = jtag_scan_type(cmd->cmd.scan);
 				if (bitbang_scan(cmd->cmd.scan->ir_scan, type, buffer,
-							scan_size) != ERROR_OK)
+							scan_size) != ERROR_OK) {
+					free(buffer);
+					bitbang_complete_pending(true);
 					return ERROR_FAIL;
+				}
+				if (bitbang_interface->shift) {
+					/* TDO arrives with the flush at the end of the queue */
+					if (bitbang_add_pending(cmd->cmd.scan, buffer) != ERROR_OK) {
+						free(buffer);
+						bitbang_complete_pending(true);
+						return ERROR_FAIL;
+					}
+					break;
+				}
 				if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
 					retval = ERROR_JTAG_QUEUE_FAILED;
 				free(buffer);
 				break;
 			case JTAG_SLEEP:
 				LOG_DEBUG_IO("sleep %" PRIu32, cmd->cmd.sleep->us);
+				/* the clocks before the sleep must have happened */
+				if (bitbang_interface->shift && bitbang_interface->flush(false) != ERROR_OK) {
+					bitbang_complete_pending(true);
+					return ERROR_FAIL;
+				}
 				jtag_sleep(cmd->cmd.sleep->us);
 				break;
 			case JTAG_TMS:
@@ -373,6 +468,15 @@ int bitbang_execute_queue(void)
 		}
 		cmd = cmd->next;
 	}
+
+	if (bitbang_interface->shift) {
+		int retval2 = bitbang_complete_pending(false);
+		if (retval2 == ERROR_FAIL)
+			return ERROR_FAIL;
+		if (retval2 != ERROR_OK)
+			retval = retval2;
+	}
+
 	if (bitbang_interface->blink) {
 		if (bitbang_interface->blink(0) != ERROR_OK)
 			return ERROR_FAIL;
@@ -65,6 +65,19 @@ struct bitbang_interface {
 
 	/** Set SWCLK and SWDIO to the given value. */
 	int (*swd_write)(int swclk, int swdio);
+
+	/** Clock num_bits cycles. For each one drive TCK low with the next
+	 * TMS and TDI bits (LSB first, NULL for all zero), sample TDO into tdo
+	 * unless it is NULL, and drive TCK high. The TDI bits are consumed
+	 * before returning and tdo may be the same buffer, but TDO may only be
+	 * stored by the next flush(). Optional; when implemented it is used
+	 * for scans and idle clocks instead of write() and sample(). */
+	int (*shift)(const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo,
+			unsigned int num_bits);
+
+	/** Complete all shift() calls and store their TDO, or with discard set
+	 * throw it away, as its buffers may be gone. Required with shift(). */
+	int (*flush)(bool discard);
 };
 
 extern const struct swd_driver bitbang_swd;
@@ -30,61 +30,36 @@
 /* arbitrary limit on host name length: */
 #define REMOTE_BITBANG_HOST_MAX 255
 
+/* Largest block of bits sent with one 'S' or 'T' command */
+#define REMOTE_BITBANG_BLOCK_MAX 131072
+/* TDO bytes the server may have to send before we read them. Kept well
+ * below common socket buffer sizes, so the server never blocks writing TDO
+ * while we block writing more blocks. */
+#define REMOTE_BITBANG_TDO_MAX 16384
+#define REMOTE_BITBANG_TDO_CHUNKS 1024
+
 static char *remote_bitbang_host;
 static char *remote_bitbang_port;
+static unsigned int remote_bitbang_block_size = 32768;
 
 static FILE *remote_bitbang_file;
 static int remote_bitbang_fd;
 
-/* Circular buffer. When start == end, the buffer is empty. */
-static char remote_bitbang_buf[64];
+/* Receive buffer. Data is read only when it is empty, so it stays linear:
+ * when start == end, the buffer is empty. */
+static char remote_bitbang_buf[4096];
 static unsigned remote_bitbang_start;
 static unsigned remote_bitbang_end;
 
-static int remote_bitbang_buf_full(void)
-{
-	return remote_bitbang_end ==
-		((remote_bitbang_start + sizeof(remote_bitbang_buf) - 1) %
-		 sizeof(remote_bitbang_buf));
-}
+/* Destinations for the TDO of the blocks sent since the last flush */
+static struct {
+	uint8_t *tdo;
+	unsigned int bytes;
+} remote_bitbang_tdo[REMOTE_BITBANG_TDO_CHUNKS];
+static unsigned int remote_bitbang_num_tdo;
+static unsigned int remote_bitbang_tdo_bytes;
 
-/* Read any incoming data, placing it into the buffer. */
-static int remote_bitbang_fill_buf(void)
-{
-	socket_nonblock(remote_bitbang_fd);
-	while (!remote_bitbang_buf_full()) {
-		unsigned contiguous_available_space;
-		if (remote_bitbang_end >= remote_bitbang_start) {
-			contiguous_available_space = sizeof(remote_bitbang_buf) -
-				remote_bitbang_end;
-			if (remote_bitbang_start == 0)
-				contiguous_available_space -= 1;
-		} else {
-			contiguous_available_space = remote_bitbang_start -
-				remote_bitbang_end - 1;
-		}
-		ssize_t count = read(remote_bitbang_fd,
-				remote_bitbang_buf + remote_bitbang_end,
-				contiguous_available_space);
-		if (count > 0) {
-			remote_bitbang_end += count;
-			if (remote_bitbang_end == sizeof(remote_bitbang_buf))
-				remote_bitbang_end = 0;
-		} else if (count == 0) {
-			return ERROR_OK;
-		} else if (count < 0) {
-			if (errno == EAGAIN) {
-				return ERROR_OK;
-			} else {
-				LOG_ERROR("remote_bitbang_fill_buf: %s (%d)",
-						strerror(errno), errno);
-				return ERROR_FAIL;
-			}
-		}
-	}
-
-	return ERROR_OK;
-}
+static const uint8_t remote_bitbang_zeros[REMOTE_BITBANG_BLOCK_MAX / 8];
 
 static int remote_bitbang_putc(int c)
 {
@@ -135,45 +110,63 @@ static bb_value_t char_to_int(int c)
 	}
 }
 
-/* Get the next read response. */
-static bb_value_t remote_bitbang_rread(void)
+/* Send everything written so far and wait for more incoming data. Only
+ * called with an empty receive buffer. */
+static int remote_bitbang_fill_buf(void)
 {
 	if (EOF == fflush(remote_bitbang_file)) {
-		remote_bitbang_quit();
 		LOG_ERROR("fflush: %s", strerror(errno));
-		return BB_ERROR;
+		return ERROR_FAIL;
 	}
 
-	/* Enable blocking access. */
 	socket_block(remote_bitbang_fd);
-	char c;
-	ssize_t count = read(remote_bitbang_fd, &c, 1);
-	if (count == 1) {
-		return char_to_int(c);
-	} else {
-		remote_bitbang_quit();
-		LOG_ERROR("read: count=%d, error=%s", (int) count, strerror(errno));
-		return BB_ERROR;
+	ssize_t count = read(remote_bitbang_fd, remote_bitbang_buf,
+			sizeof(remote_bitbang_buf));
+	if (count <= 0) {
+		LOG_ERROR("read: count=%d, error=%s", (int) count,
+				count ? strerror(errno) : "connection closed");
+		return ERROR_FAIL;
+	}
+
+	remote_bitbang_start = 0;
+	remote_bitbang_end = count;
+	return ERROR_OK;
+}
+
+/* Read exactly size bytes, starting with what is already buffered. With
+ * data NULL the bytes are skipped. */
+static int remote_bitbang_read_exact(uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		if (remote_bitbang_start == remote_bitbang_end) {
+			if (remote_bitbang_fill_buf() != ERROR_OK)
+				return ERROR_FAIL;
+		}
+		size_t count = MIN(size, remote_bitbang_end - remote_bitbang_start);
+		if (data) {
+			memcpy(data, remote_bitbang_buf + remote_bitbang_start, count);
+			data += count;
+		}
+		remote_bitbang_start += count;
+		size -= count;
 	}
+	return ERROR_OK;
 }
 
 static int remote_bitbang_sample(void)
 {
-	if (remote_bitbang_fill_buf() != ERROR_OK)
-		return ERROR_FAIL;
-	assert(!remote_bitbang_buf_full());
 	return remote_bitbang_putc('R');
 }
 
 static bb_value_t remote_bitbang_read_sample(void)
 {
-	if (remote_bitbang_start != remote_bitbang_end) {
-		int c = remote_bitbang_buf[remote_bitbang_start];
-		remote_bitbang_start =
-			(remote_bitbang_start + 1) % sizeof(remote_bitbang_buf);
-		return char_to_int(c);
+	if (remote_bitbang_start == remote_bitbang_end) {
+		if (remote_bitbang_fill_buf() != ERROR_OK) {
+			remote_bitbang_quit();
+			return BB_ERROR;
+		}
 	}
-	return remote_bitbang_rread();
+	return char_to_int(remote_bitbang_buf[remote_bitbang_start++]);
 }
 
 static int remote_bitbang_write(int tck, int tms, int tdi)
@@ -194,6 +187,67 @@ static int remote_bitbang_blink(int on)
 	return remote_bitbang_putc(c);
 }
 
+/* Send what is buffered and read the TDO of all blocks sent so far into
+ * their destinations, or just drain it from the socket. */
+static int remote_bitbang_flush(bool discard)
+{
+	int retval = ERROR_OK;
+
+	if (EOF == fflush(remote_bitbang_file)) {
+		LOG_ERROR("fflush: %s", strerror(errno));
+		retval = ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < remote_bitbang_num_tdo && retval == ERROR_OK; i++)
+		retval = remote_bitbang_read_exact(discard ? NULL : remote_bitbang_tdo[i].tdo,
+				remote_bitbang_tdo[i].bytes);
+
+	/* the destinations are never used again, whatever happened */
+	remote_bitbang_num_tdo = 0;
+	remote_bitbang_tdo_bytes = 0;
+	return retval;
+}
+
+/* Send the bits in blocks of at most remote_bitbang_block_size, which is a
+ * multiple of 8, so every block starts on a byte boundary. A block is 'S'
+ * (TDO wanted) or 'T', the bit count as 32 bit little endian, the TMS bytes
+ * and the TDI bytes. The server answers 'S' with the TDO bytes. */
+static int remote_bitbang_shift(const uint8_t *tms, const uint8_t *tdi,
+		uint8_t *tdo, unsigned int num_bits)
+{
+	for (unsigned int offset = 0; offset < num_bits; ) {
+		unsigned int bits = MIN(num_bits - offset, remote_bitbang_block_size);
+		unsigned int bytes = DIV_ROUND_UP(bits, 8);
+		uint8_t header[5];
+
+		if (tdo && (remote_bitbang_tdo_bytes + bytes > REMOTE_BITBANG_TDO_MAX ||
+				remote_bitbang_num_tdo == REMOTE_BITBANG_TDO_CHUNKS)) {
+			if (remote_bitbang_flush(false) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+
+		header[0] = tdo ? 'S' : 'T';
+		h_u32_to_le(header + 1, bits);
+		if (fwrite(header, sizeof(header), 1, remote_bitbang_file) != 1 ||
+				fwrite(tms ? tms + offset / 8 : remote_bitbang_zeros,
+					bytes, 1, remote_bitbang_file) != 1 ||
+				fwrite(tdi ? tdi + offset / 8 : remote_bitbang_zeros,
+					bytes, 1, remote_bitbang_file) != 1) {
+			LOG_ERROR("fwrite: %s", strerror(errno));
+			return ERROR_FAIL;
+		}
+
+		if (tdo) {
+			remote_bitbang_tdo[remote_bitbang_num_tdo].tdo = tdo + offset / 8;
+			remote_bitbang_tdo[remote_bitbang_num_tdo].bytes = bytes;
+			remote_bitbang_num_tdo++;
+			remote_bitbang_tdo_bytes += bytes;
+		}
+		offset += bits;
+	}
+	return ERROR_OK;
+}
+
 static struct bitbang_interface remote_bitbang_bitbang = {
 	.buf_size = sizeof(remote_bitbang_buf) - 1,
 	.sample = &remote_bitbang_sample,
@@ -202,6 +256,51 @@ static struct bitbang_interface remote_bitbang_bitbang = {
 	.blink = &remote_bitbang_blink,
 };
 
+/* Ask for the block extension with 'X'. Servers that know it answer "X"
+ * and a version digit, old ones ignore the unknown command. The 'R' that
+ * follows tells when to stop waiting for the answer. */
+static int remote_bitbang_negotiate(void)
+{
+	uint8_t c;
+
+	remote_bitbang_bitbang.shift = NULL;
+	remote_bitbang_bitbang.flush = NULL;
+
+	if (remote_bitbang_block_size == 0)
+		return ERROR_OK;
+
+	if (remote_bitbang_putc('X') != ERROR_OK ||
+			remote_bitbang_putc('R') != ERROR_OK ||
+			remote_bitbang_read_exact(&c, 1) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (c == '0' || c == '1') {
+		LOG_INFO("remote_bitbang server has no block support, "
+				"using one command per clock");
+		return ERROR_OK;
+	}
+
+	if (c != 'X' || remote_bitbang_read_exact(&c, 1) != ERROR_OK || c < '1') {
+		LOG_ERROR("remote_bitbang: invalid block negotiation response");
+		return ERROR_FAIL;
+	}
+
+	/* the answer to our 'R' */
+	uint8_t sample;
+	if (remote_bitbang_read_exact(&sample, 1) != ERROR_OK)
+		return ERROR_FAIL;
+	if (sample != '0' && sample != '1') {
+		LOG_ERROR("remote_bitbang: invalid read response: %c(%i)", sample, sample);
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("remote_bitbang server supports block protocol version %c, "
+			"using blocks of up to %u bits", c, remote_bitbang_block_size);
+	remote_bitbang_bitbang.shift = &remote_bitbang_shift;
+	remote_bitbang_bitbang.flush = &remote_bitbang_flush;
+	return ERROR_OK;
+}
+
 static int remote_bitbang_init_tcp(void)
 {
 	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
@@ -278,6 +377,8 @@ static int remote_bitbang_init(void)
 
 	remote_bitbang_start = 0;
 	remote_bitbang_end = 0;
+	remote_bitbang_num_tdo = 0;
+	remote_bitbang_tdo_bytes = 0;
 
 	LOG_INFO("Initializing remote_bitbang driver");
 	if (remote_bitbang_port == NULL)
@@ -294,6 +395,13 @@ static int remote_bitbang_init(void)
 		close(remote_bitbang_fd);
 		return ERROR_FAIL;
 	}
+	/* Leave the flushing to us: blocks are much larger than BUFSIZ */
+	setvbuf(remote_bitbang_file, NULL, _IOFBF, 65536);
+
+	if (remote_bitbang_negotiate() != ERROR_OK) {
+		fclose(remote_bitbang_file);
+		return ERROR_FAIL;
+	}
 
 	LOG_INFO("remote_bitbang driver initialized");
 	return ERROR_OK;
@@ -321,6 +429,22 @@ COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_host_command)
 	return ERROR_COMMAND_SYNTAX_ERROR;
 }
 
+COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_block_size_command)
+{
+	if (CMD_ARGC == 1) {
+		unsigned int bits;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], bits);
+		if (bits > REMOTE_BITBANG_BLOCK_MAX) {
+			LOG_ERROR("block size is limited to %d bits", REMOTE_BITBANG_BLOCK_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		/* keep every block after the first byte aligned */
+		remote_bitbang_block_size = bits & ~7u;
+		return ERROR_OK;
+	}
+	return ERROR_COMMAND_SYNTAX_ERROR;
+}
+
 static const struct command_registration remote_bitbang_command_handlers[] = {
 	{
 		.name = "remote_bitbang_port",
@@ -338,6 +462,14 @@ static const struct command_registration remote_bitbang_command_handlers[] = {
 			"  if port is 0 or unset, this is the name of the unix socket to use.",
 		.usage = "host_name",
 	},
+	{
+		.name = "remote_bitbang_block_size",
+		.handler = remote_bitbang_handle_remote_bitbang_block_size_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Set the largest number of bits sent in one block command.\n"
+			"  if 0, only the one command per clock protocol is used.",
+		.usage = "bits",
+	},
 	COMMAND_REGISTRATION_DONE,
 };
 
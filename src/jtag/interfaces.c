@@ -155,6 +155,9 @@ extern struct adapter_driver stlink_dap_adapter_driver;
 #if BUILD_RSHIM == 1
 extern struct adapter_driver rshim_dap_adapter_driver;
 #endif
+#if BUILD_ADISIM == 1
+extern struct adapter_driver adisim_adapter_driver;
+#endif
 #endif /* standard drivers */
 
 /**
@@ -278,6 +281,9 @@ struct adapter_driver *adapter_drivers[] = {
 #if BUILD_RSHIM == 1
 		&rshim_dap_adapter_driver,
 #endif
+#if BUILD_ADISIM == 1
+		&adisim_adapter_driver,
+#endif
 #endif /* standard drivers */
 		NULL,
 	};
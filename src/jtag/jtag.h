@@ -24,6 +24,7 @@
 
 #include <helper/binarybuffer.h>
 #include <helper/log.h>
+#include <helper/time_support.h>
 
 #ifndef DEBUG_JTAG_IOZ
 #define DEBUG_JTAG_IOZ 64
@@ -570,6 +571,21 @@ void jtag_execute_queue_noclear(void);
 /** @returns the number of times the scan queue has been flushed */
 int jtag_get_flush_queue_count(void);
 
+/** Scan and flush statistics of the JTAG layer, reported by "adapter stats" */
+struct jtag_stats {
+	uint64_t ir_scans;
+	uint64_t dr_scans;
+	/* bits of the scanned fields, excluding bypassed TAPs */
+	uint64_t scan_bits;
+	uint64_t idle_clocks;
+	/* duration of jtag_execute_queue() flushes */
+	struct latency_hist flushes;
+};
+
+/** @returns the statistics collected since startup or the last reset */
+const struct jtag_stats *jtag_get_stats(void);
+void jtag_reset_stats(void);
+
 /** Report Tcl event to all TAPs */
 void jtag_notify_event(enum jtag_event);
 
@@ -240,23 +240,51 @@ static int hwthread_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		return ERROR_FAIL;
 
 	struct reg **reg_list;
-	int retval = target_get_gdb_reg_list(curr, &reg_list, rtos_reg_list_size,
+	int reg_list_size;
+	int retval = target_get_gdb_reg_list(curr, &reg_list, &reg_list_size,
 			REG_CLASS_GENERAL);
 	if (retval != ERROR_OK)
 		return retval;
 
-	*rtos_reg_list = calloc(*rtos_reg_list_size, sizeof(struct rtos_reg));
+	*rtos_reg_list = calloc(reg_list_size, sizeof(struct rtos_reg));
 	if (*rtos_reg_list == NULL) {
 		free(reg_list);
 		return ERROR_FAIL;
 	}
 
-	for (int i = 0; i < *rtos_reg_list_size; i++) {
-		(*rtos_reg_list)[i].number = (*reg_list)[i].number;
-		(*rtos_reg_list)[i].size = (*reg_list)[i].size;
-		memcpy((*rtos_reg_list)[i].value, (*reg_list)[i].value,
-				((*reg_list)[i].size + 7) / 8);
+	/*
+	 * Serve the registers from the register cache of the thread's target.
+	 * Only registers that are not cached yet are fetched; targets which
+	 * defer their debug entry read the whole context on the first one,
+	 * so every later packet for this thread is answered from host memory
+	 * until the target resumes.
+	 */
+	int j = 0;
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *reg = reg_list[i];
+
+		/* same layout as gdb_get_registers_packet() */
+		if (reg == NULL || !reg->exist || reg->hidden)
+			continue;
+
+		if (!reg->valid) {
+			retval = reg->type->get(reg);
+			if (retval != ERROR_OK) {
+				free(*rtos_reg_list);
+				*rtos_reg_list = NULL;
+				free(reg_list);
+				return retval;
+			}
+		}
+
+		(*rtos_reg_list)[j].number = reg->number;
+		(*rtos_reg_list)[j].size = reg->size;
+		unsigned bytes = (reg->size + 7) / 8;
+		assert(bytes <= sizeof((*rtos_reg_list)[j].value));
+		memcpy((*rtos_reg_list)[j].value, reg->value, bytes);
+		j++;
 	}
+	*rtos_reg_list_size = j;
 	free(reg_list);
 
 	return ERROR_OK;
@@ -288,7 +316,7 @@ static int hwthread_get_thread_reg(struct rtos *rtos, int64_t thread_id,
 		return ERROR_FAIL;
 	}
 
-	if (reg->type->get(reg) != ERROR_OK)
+	if (!reg->valid && reg->type->get(reg) != ERROR_OK)
 		return ERROR_FAIL;
 
 	rtos_reg->number = reg->number;
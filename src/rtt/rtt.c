@@ -50,6 +50,19 @@ static struct {
 	size_t sink_list_length;
 
 	unsigned int polling_interval;
+	/** Longest interval for adaptive polling, 0 if disabled. */
+	unsigned int polling_interval_max;
+	/** Number of timer ticks to skip between polls. */
+	unsigned int poll_skip;
+	/** Number of timer ticks skipped since the last poll. */
+	unsigned int poll_skip_count;
+	/** Highest fill level of any up-channel at the last poll, in 1/8. */
+	unsigned int poll_fill;
+	/** Maximum number of bytes read from each up-channel per poll. */
+	unsigned int buffer_size;
+
+	struct rtt_channel_stats *stats;
+	size_t stats_length;
 } rtt;
 
 int rtt_init(void)
@@ -65,6 +78,7 @@ int rtt_init(void)
 	rtt.started = false;
 
 	rtt.polling_interval = 100;
+	rtt.buffer_size = 1024;
 
 	return ERROR_OK;
 }
@@ -72,14 +86,44 @@ int rtt_init(void)
 int rtt_exit(void)
 {
 	free(rtt.sink_list);
+	free(rtt.stats);
 
 	return ERROR_OK;
 }
 
+static void adapt_polling(void)
+{
+	unsigned int max_skip;
+
+	if (rtt.polling_interval_max <= rtt.polling_interval) {
+		rtt.poll_skip = 0;
+		return;
+	}
+
+	max_skip = rtt.polling_interval_max / rtt.polling_interval - 1;
+
+	if (rtt.poll_fill >= 4) {
+		/* half full or more: poll at full rate before data is lost */
+		rtt.poll_skip = 0;
+	} else if (rtt.poll_fill >= 2) {
+		rtt.poll_skip /= 2;
+	} else if (rtt.poll_fill == 0) {
+		rtt.poll_skip = MIN(rtt.poll_skip * 2 + 1, max_skip);
+	}
+}
+
 static int read_channel_callback(void *user_data)
 {
 	int ret;
 
+	if (rtt.poll_skip_count < rtt.poll_skip) {
+		rtt.poll_skip_count++;
+		return ERROR_OK;
+	}
+
+	rtt.poll_skip_count = 0;
+	rtt.poll_fill = 0;
+
 	ret = rtt.source.read(rtt.target, &rtt.ctrl, rtt.sink_list,
 		rtt.sink_list_length, NULL);
 
@@ -89,6 +133,8 @@ static int read_channel_callback(void *user_data)
 		return ret;
 	}
 
+	adapt_polling();
+
 	return ERROR_OK;
 }
 
@@ -162,6 +208,8 @@ int rtt_start(void)
 	if (ret != ERROR_OK)
 		return ret;
 
+	rtt_reset_channel_stats();
+
 	target_register_timer_callback(&read_channel_callback,
 		rtt.polling_interval, 1, NULL);
 	rtt.started = true;
@@ -292,6 +340,96 @@ int rtt_set_polling_interval(unsigned int interval)
 	return ERROR_OK;
 }
 
+int rtt_get_polling_interval_max(unsigned int *interval)
+{
+	if (!interval)
+		return ERROR_FAIL;
+
+	*interval = rtt.polling_interval_max;
+
+	return ERROR_OK;
+}
+
+int rtt_set_polling_interval_max(unsigned int interval)
+{
+	rtt.polling_interval_max = interval;
+	rtt.poll_skip = 0;
+	rtt.poll_skip_count = 0;
+
+	return ERROR_OK;
+}
+
+unsigned int rtt_get_current_polling_interval(void)
+{
+	return rtt.polling_interval * (rtt.poll_skip + 1);
+}
+
+void rtt_update_channel_stats(unsigned int channel_index, uint32_t size,
+		uint32_t level, size_t length)
+{
+	struct rtt_channel_stats *stats;
+
+	if (channel_index >= rtt.stats_length) {
+		stats = realloc(rtt.stats, (channel_index + 1) * sizeof(*stats));
+
+		if (!stats)
+			return;
+
+		memset(stats + rtt.stats_length, 0,
+			(channel_index + 1 - rtt.stats_length) * sizeof(*stats));
+		rtt.stats = stats;
+		rtt.stats_length = channel_index + 1;
+	}
+
+	stats = &rtt.stats[channel_index];
+	stats->size = size;
+	stats->high_water = MAX(stats->high_water, level);
+	stats->polls++;
+	stats->bytes += length;
+
+	/* one byte always stays free to tell a full buffer from an empty one */
+	if (size && level >= size - 1)
+		stats->full++;
+
+	if (size)
+		rtt.poll_fill = MAX(rtt.poll_fill, (unsigned int)((uint64_t)level * 8 / size));
+}
+
+const struct rtt_channel_stats *rtt_get_channel_stats(
+		unsigned int channel_index)
+{
+	if (channel_index >= rtt.stats_length || !rtt.stats[channel_index].polls)
+		return NULL;
+
+	return &rtt.stats[channel_index];
+}
+
+void rtt_reset_channel_stats(void)
+{
+	if (rtt.stats)
+		memset(rtt.stats, 0, rtt.stats_length * sizeof(*rtt.stats));
+}
+
+int rtt_get_buffer_size(unsigned int *size)
+{
+	if (!size)
+		return ERROR_FAIL;
+
+	*size = rtt.buffer_size;
+
+	return ERROR_OK;
+}
+
+int rtt_set_buffer_size(unsigned int size)
+{
+	if (!size)
+		return ERROR_FAIL;
+
+	rtt.buffer_size = size;
+
+	return ERROR_OK;
+}
+
 int rtt_write_channel(unsigned int channel_index, const uint8_t *buffer,
 		size_t *length)
 {
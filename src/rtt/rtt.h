@@ -88,6 +88,23 @@ struct rtt_channel_info {
 	uint32_t flags;
 };
 
+/** Per up-channel statistics gathered while polling. */
+struct rtt_channel_stats {
+	/** Buffer size in bytes. */
+	uint32_t size;
+	/** Highest fill level seen at a poll, in bytes. */
+	uint32_t high_water;
+	/**
+	 * Number of polls that found the buffer full. Depending on the
+	 * channel mode the target dropped or blocked on data in between.
+	 */
+	uint32_t full;
+	/** Number of polls. */
+	uint32_t polls;
+	/** Number of bytes read. */
+	uint64_t bytes;
+};
+
 typedef int (*rtt_sink_read)(unsigned int channel, const uint8_t *buffer,
 		size_t length, void *user_data);
 
@@ -205,6 +222,83 @@ int rtt_get_polling_interval(unsigned int *interval);
  */
 int rtt_set_polling_interval(unsigned int interval);
 
+/**
+ * Get the longest polling interval adaptive polling backs off to.
+ *
+ * @param[out] interval Polling interval in milliseconds, 0 when adaptive
+ *                      polling is disabled.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_get_polling_interval_max(unsigned int *interval);
+
+/**
+ * Set the longest polling interval adaptive polling backs off to.
+ *
+ * While the up-channels stay (nearly) empty, polls are skipped so that the
+ * effective interval grows from the polling interval up to this value. It
+ * snaps back to the polling interval once a channel fills up.
+ *
+ * @param[in] interval Polling interval in milliseconds, 0 to disable.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_set_polling_interval_max(unsigned int interval);
+
+/**
+ * Get the effective polling interval.
+ *
+ * @returns The current polling interval in milliseconds.
+ */
+unsigned int rtt_get_current_polling_interval(void);
+
+/**
+ * Record the state of an up-channel seen by a poll.
+ *
+ * Called by the RTT source for each polled up-channel, feeds the channel
+ * statistics and the adaptive polling.
+ *
+ * @param[in] channel_index Channel index.
+ * @param[in] size Channel buffer size in bytes.
+ * @param[in] level Fill level of the buffer in bytes.
+ * @param[in] length Number of bytes read from the channel.
+ */
+void rtt_update_channel_stats(unsigned int channel_index, uint32_t size,
+		uint32_t level, size_t length);
+
+/**
+ * Get the statistics of an up-channel.
+ *
+ * @param[in] channel_index Channel index.
+ *
+ * @returns The channel statistics or NULL if the channel was never polled.
+ */
+const struct rtt_channel_stats *rtt_get_channel_stats(
+		unsigned int channel_index);
+
+/**
+ * Reset the statistics of all up-channels.
+ */
+void rtt_reset_channel_stats(void);
+
+/**
+ * Get the maximum number of bytes read from each up-channel per poll.
+ *
+ * @param[out] size Read buffer size in bytes.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_get_buffer_size(unsigned int *size);
+
+/**
+ * Set the maximum number of bytes read from each up-channel per poll.
+ *
+ * @param[in] size Read buffer size in bytes.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_set_buffer_size(unsigned int size);
+
 /**
  * Get whether RTT is started.
  *
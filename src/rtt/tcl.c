@@ -104,6 +104,111 @@ COMMAND_HANDLER(handle_rtt_polling_interval_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_rtt_polling_interval_max_command)
+{
+	if (CMD_ARGC == 0) {
+		int ret;
+		unsigned int interval;
+
+		ret = rtt_get_polling_interval_max(&interval);
+
+		if (ret != ERROR_OK) {
+			command_print(CMD, "Failed to get maximum polling interval");
+			return ret;
+		}
+
+		if (interval)
+			command_print(CMD, "%u ms", interval);
+		else
+			command_print(CMD, "disabled");
+	} else if (CMD_ARGC == 1) {
+		int ret;
+		unsigned int interval;
+
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], interval);
+		ret = rtt_set_polling_interval_max(interval);
+
+		if (ret != ERROR_OK) {
+			command_print(CMD, "Failed to set maximum polling interval");
+			return ret;
+		}
+	} else {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_stats_command)
+{
+	const struct rtt_channel_stats *stats;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		rtt_reset_channel_stats();
+		return ERROR_OK;
+	} else if (CMD_ARGC > 1) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (!rtt_found_cb()) {
+		command_print(CMD, "rtt: Control block not available");
+		return ERROR_FAIL;
+	}
+
+	command_print(CMD, "Current polling interval: %u ms",
+		rtt_get_current_polling_interval());
+	command_print(CMD, "Up-channels:");
+
+	for (unsigned int i = 0; i < rtt_get_control()->num_up_channels; i++) {
+		stats = rtt_get_channel_stats(i);
+
+		if (!stats)
+			continue;
+
+		command_print(CMD, "%u: size=%" PRIu32 " high_water=%" PRIu32
+			" full=%" PRIu32 " polls=%" PRIu32 " bytes=%" PRIu64, i,
+			stats->size, stats->high_water, stats->full, stats->polls,
+			stats->bytes);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_buffer_size_command)
+{
+	if (CMD_ARGC == 0) {
+		int ret;
+		unsigned int size;
+
+		ret = rtt_get_buffer_size(&size);
+
+		if (ret != ERROR_OK) {
+			command_print(CMD, "Failed to get buffer size");
+			return ret;
+		}
+
+		command_print(CMD, "%u bytes", size);
+	} else if (CMD_ARGC == 1) {
+		int ret;
+		unsigned int size;
+
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		ret = rtt_set_buffer_size(size);
+
+		if (ret != ERROR_OK) {
+			command_print(CMD, "Failed to set buffer size");
+			return ret;
+		}
+	} else {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_rtt_channels_command)
 {
 	int ret;
@@ -282,6 +387,29 @@ static const struct command_registration rtt_subcommand_handlers[] = {
 		.help = "show or set polling interval in ms",
 		.usage = "[interval]"
 	},
+	{
+		.name = "polling_interval_max",
+		.handler = handle_rtt_polling_interval_max_command,
+		.mode = COMMAND_EXEC,
+		.help = "show or set the longest interval in ms adaptive "
+			"polling backs off to, 0 disables adaptive polling",
+		.usage = "[interval]"
+	},
+	{
+		.name = "buffer_size",
+		.handler = handle_rtt_buffer_size_command,
+		.mode = COMMAND_ANY,
+		.help = "show or set maximum number of bytes read from an "
+			"up-channel per poll",
+		.usage = "[size]"
+	},
+	{
+		.name = "stats",
+		.handler = handle_rtt_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show or reset up-channel fill level statistics",
+		.usage = "[reset]"
+	},
 	{
 		.name = "channels",
 		.handler = handle_rtt_channels_command,
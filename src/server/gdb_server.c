@@ -71,6 +71,10 @@ struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
 	char *buf_p;
 	int buf_cnt;
+	/* storage for one incoming packet, sized from gdb_packet_size when the
+	 * connection is opened */
+	char *packet_buffer;
+	int packet_size;
 	bool ctrl_c;
 	enum target_state frontend_state;
 	struct image *vflash_image;
@@ -97,6 +101,8 @@ struct gdb_connection {
 	struct target_desc_format target_desc;
 	/* temporarily used for thread list support */
 	char *thread_list;
+	/* set when GDB announced binary-upload, 'x' replies then start with 'b' */
+	bool binary_upload;
 };
 
 #if 0
@@ -142,6 +148,11 @@ static int gdb_report_register_access_error;
 /* enabled by default */
 static int gdb_use_target_description = 1;
 
+/* packet size advertised to gdb in the qSupported reply; applies to
+ * connections opened after it is changed */
+#define GDB_PACKET_SIZE_MAX (4 * 1024 * 1024)
+static unsigned int gdb_packet_size = GDB_BUFFER_SIZE;
+
 /* current processing free-run type, used by file-I/O */
 static char gdb_running_type;
 
@@ -357,6 +368,61 @@ static int gdb_write(struct connection *connection, void *data, int len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+/* Wait for GDB to acknowledge a packet. On a negative reply *retry is set
+ * and the packet has to be sent again. */
+static int gdb_get_packet_ack(struct connection *connection, bool *retry)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	int reply;
+	int retval;
+
+	*retry = false;
+
+	if (gdb_con->noack_mode)
+		return ERROR_OK;
+
+	retval = gdb_get_char(connection, &reply);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (reply == 0x3) {
+		gdb_con->ctrl_c = true;
+		retval = gdb_get_char(connection, &reply);
+		if (retval != ERROR_OK)
+			return retval;
+		if (reply == '$') {
+			LOG_ERROR("GDB missing ack(1) - assumed good");
+			gdb_putback_char(connection, reply);
+			return ERROR_OK;
+		} else if (reply != '+' && reply != '-') {
+			LOG_ERROR("unknown character(1) 0x%2.2x in reply, dropping connection", reply);
+			gdb_con->closed = true;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+	} else if (reply == '$') {
+		LOG_ERROR("GDB missing ack(2) - assumed good");
+		gdb_putback_char(connection, reply);
+		return ERROR_OK;
+	} else if (reply != '+' && reply != '-') {
+		LOG_ERROR("unknown character(2) 0x%2.2x in reply, dropping connection",
+			reply);
+		gdb_con->closed = true;
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	if (reply == '-') {
+		/* Stop sending output packets for now */
+		log_remove_callback(gdb_log_callback, connection);
+		LOG_WARNING("negative reply, retrying");
+		*retry = true;
+	}
+
+	if (gdb_con->closed)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
 static int gdb_put_packet_inner(struct connection *connection,
 		char *buffer, int len)
 {
@@ -364,10 +430,9 @@ static int gdb_put_packet_inner(struct connection *connection,
 	unsigned char my_checksum = 0;
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
-#endif
 	int reply;
+#endif
 	int retval;
-	struct gdb_connection *gdb_con = connection->priv;
 
 	for (i = 0; i < len; i++)
 		my_checksum += buffer[i];
@@ -430,54 +495,11 @@ static int gdb_put_packet_inner(struct connection *connection,
 				return retval;
 		}
 
-		if (gdb_con->noack_mode)
-			break;
-
-		retval = gdb_get_char(connection, &reply);
-		if (retval != ERROR_OK)
+		bool retry;
+		retval = gdb_get_packet_ack(connection, &retry);
+		if (retval != ERROR_OK || !retry)
 			return retval;
-
-		if (reply == '+')
-			break;
-		else if (reply == '-') {
-			/* Stop sending output packets for now */
-			log_remove_callback(gdb_log_callback, connection);
-			LOG_WARNING("negative reply, retrying");
-		} else if (reply == 0x3) {
-			gdb_con->ctrl_c = true;
-			retval = gdb_get_char(connection, &reply);
-			if (retval != ERROR_OK)
-				return retval;
-			if (reply == '+')
-				break;
-			else if (reply == '-') {
-				/* Stop sending output packets for now */
-				log_remove_callback(gdb_log_callback, connection);
-				LOG_WARNING("negative reply, retrying");
-			} else if (reply == '$') {
-				LOG_ERROR("GDB missing ack(1) - assumed good");
-				gdb_putback_char(connection, reply);
-				return ERROR_OK;
-			} else {
-				LOG_ERROR("unknown character(1) 0x%2.2x in reply, dropping connection", reply);
-				gdb_con->closed = true;
-				return ERROR_SERVER_REMOTE_CLOSED;
-			}
-		} else if (reply == '$') {
-			LOG_ERROR("GDB missing ack(2) - assumed good");
-			gdb_putback_char(connection, reply);
-			return ERROR_OK;
-		} else {
-			LOG_ERROR("unknown character(2) 0x%2.2x in reply, dropping connection",
-				reply);
-			gdb_con->closed = true;
-			return ERROR_SERVER_REMOTE_CLOSED;
-		}
 	}
-	if (gdb_con->closed)
-		return ERROR_SERVER_REMOTE_CLOSED;
-
-	return ERROR_OK;
 }
 
 int gdb_put_packet(struct connection *connection, char *buffer, int len)
@@ -935,6 +957,18 @@ static int gdb_new_connection(struct connection *connection)
 	int retval;
 	int initial_ack;
 
+	if (!gdb_connection)
+		return ERROR_FAIL;
+
+	/* Extra byte for null-termination */
+	gdb_connection->packet_buffer = malloc(gdb_packet_size + 1);
+	if (!gdb_connection->packet_buffer) {
+		LOG_ERROR("Unable to allocate %u bytes for the GDB packet buffer", gdb_packet_size);
+		free(gdb_connection);
+		return ERROR_FAIL;
+	}
+	gdb_connection->packet_size = gdb_packet_size;
+
 	target = get_target_from_connection(connection);
 	connection->priv = gdb_connection;
 	connection->cmd_ctx->current_target = target;
@@ -1010,7 +1044,10 @@ static int gdb_new_connection(struct connection *connection)
 		}
 	}
 
+	struct gdb_service *gdb_service = connection->service->priv;
+
 	gdb_actual_connections++;
+	gdb_service->connections++;
 	log_printf_lf(all_targets->next != NULL ? LOG_LVL_INFO : LOG_LVL_DEBUG,
 			__FILE__, __LINE__, __func__,
 			"New GDB Connection: %d, Target %s, state: %s",
@@ -1022,6 +1059,7 @@ static int gdb_new_connection(struct connection *connection)
 		LOG_ERROR("Target %s not examined yet, refuse gdb connection %d!",
 				  target_name(target), gdb_actual_connections);
 		gdb_actual_connections--;
+		gdb_service->connections--;
 		return ERROR_TARGET_NOT_EXAMINED;
 	}
 
@@ -1043,6 +1081,7 @@ static int gdb_connection_closed(struct connection *connection)
 {
 	struct target *target;
 	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
 
 	target = get_target_from_connection(connection);
 
@@ -1052,6 +1091,7 @@ static int gdb_connection_closed(struct connection *connection)
 	log_remove_callback(gdb_log_callback, connection);
 
 	gdb_actual_connections--;
+	gdb_service->connections--;
 	LOG_DEBUG("GDB Close, Target: %s, state: %s, gdb_actual_connections=%d",
 		target_name(target),
 		target_state_name(target),
@@ -1067,6 +1107,7 @@ static int gdb_connection_closed(struct connection *connection)
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
+	free(gdb_connection->packet_buffer);
 	free(connection->priv);
 	connection->priv = NULL;
 
@@ -1424,19 +1465,108 @@ static int gdb_error(struct connection *connection, int retval)
 	return ERROR_OK;
 }
 
+/* memory read replies are read from the target and encoded in chunks of this size */
+#define GDB_MEMORY_CHUNK_SIZE 4096
+
+/* Encode memory for a read reply, either as hex ('m') or escaped binary ('x').
+ * The output buffer must hold at least 2 * len bytes. */
+static size_t gdb_encode_memory(char *out, const uint8_t *in, size_t len, bool binary)
+{
+	size_t n = 0;
+
+	if (!binary)
+		return hexify(out, in, len, 2 * len + 1);
+
+	for (size_t i = 0; i < len; i++) {
+		if (in[i] == '#' || in[i] == '$' || in[i] == '}' || in[i] == '*') {
+			out[n++] = '}';
+			out[n++] = in[i] ^ 0x20;
+		} else
+			out[n++] = in[i];
+	}
+
+	return n;
+}
+
+/* Send a memory read reply, reading the target chunk by chunk while the
+ * packet is being sent. Encoded data goes straight to the socket, so the
+ * host drains chunk N while the target reads chunk N + 1. Only the raw
+ * data is kept, to be encoded again if GDB asks for a retransmission.
+ * Bytes below 'valid' are already in the buffer. */
+static int gdb_put_memory_packet(struct connection *connection,
+		uint64_t addr, uint32_t len, uint8_t *buffer, uint32_t valid,
+		bool binary, const char *prefix)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	char chunk[2 * GDB_MEMORY_CHUNK_SIZE + 1];
+	unsigned char my_checksum;
+	bool retry;
+	int retval;
+
+	gdb_con->busy = true;
+
+	do {
+		my_checksum = 0;
+		for (const char *p = prefix; *p; p++)
+			my_checksum += *p;
+
+		retval = gdb_write(connection, "$", 1);
+		if (retval == ERROR_OK)
+			retval = gdb_write(connection, (void *)prefix, strlen(prefix));
+
+		for (uint32_t offset = 0; retval == ERROR_OK && offset < len; ) {
+			uint32_t count = MIN(len - offset, GDB_MEMORY_CHUNK_SIZE);
+
+			if (offset + count > valid) {
+				if (target_read_buffer(target, addr + offset, count, buffer + offset) != ERROR_OK) {
+					/* see gdb_read_memory_packet() about sending zeroes */
+					memset(buffer + offset, 0, count);
+				}
+				valid = offset + count;
+			}
+
+			size_t n = gdb_encode_memory(chunk, buffer + offset, count, binary);
+			for (size_t i = 0; i < n; i++)
+				my_checksum += chunk[i];
+
+			retval = gdb_write(connection, chunk, n);
+			offset += count;
+		}
+
+		if (retval == ERROR_OK) {
+			snprintf(chunk, sizeof(chunk), "#%02x", my_checksum);
+			retval = gdb_write(connection, chunk, 3);
+		}
+		if (retval == ERROR_OK)
+			retval = gdb_get_packet_ack(connection, &retry);
+	} while (retval == ERROR_OK && retry);
+
+	gdb_con->busy = false;
+
+	/* we sent some data, reset timer for keep alive messages */
+	kept_alive();
+
+	return retval;
+}
+
 /* We don't have to worry about the default 2 second timeout for GDB packets,
  * because GDB breaks up large memory reads into smaller reads.
+ *
+ * Handles both the hex 'm' packet and the binary 'x' packet.
  */
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
 	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	bool binary = packet[0] == 'x';
 	char *separator;
 	uint64_t addr = 0;
 	uint32_t len = 0;
+	uint32_t valid = 0;
 
 	uint8_t *buffer;
-	char *hex_buffer;
 
 	int retval = ERROR_OK;
 
@@ -1452,45 +1582,52 @@ static int gdb_read_memory_packet(struct connection *connection,
 
 	len = strtoul(separator + 1, NULL, 16);
 
+	/* binary-upload replies are prefixed, LLDB style replies are raw */
+	const char *prefix = (binary && gdb_con->binary_upload) ? "b" : "";
+
 	if (!len) {
+		/* a zero-length 'x' is the client probing for binary reads */
+		if (binary) {
+			gdb_put_packet(connection, "OK", 2);
+			return ERROR_OK;
+		}
 		LOG_WARNING("invalid read memory packet received (len == 0)");
 		gdb_put_packet(connection, "", 0);
 		return ERROR_OK;
 	}
 
 	buffer = malloc(len);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		return gdb_error(connection, ERROR_FAIL);
+	}
 
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
-	retval = target_read_buffer(target, addr, len, buffer);
-
-	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
-		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
-		 * At some point this might be fixed in GDB, in which case this code can be removed.
-		 *
-		 * OpenOCD developers are acutely aware of this problem, but there is nothing
-		 * gained by involving the user in this problem that hopefully will get resolved
-		 * eventually
-		 *
-		 * http://sourceware.org/cgi-bin/gnatsweb.pl? \
-		 * cmd = view%20audit-trail&database = gdb&pr = 2395
-		 *
-		 * For now, the default is to fix up things to make current GDB versions work.
-		 * This can be overwritten using the gdb_report_data_abort <'enable'|'disable'> command.
-		 */
-		memset(buffer, 0, len);
-		retval = ERROR_OK;
+	if (gdb_report_data_abort) {
+		/* an error must be reported before the reply is started */
+		retval = target_read_buffer(target, addr, len, buffer);
+		valid = len;
 	}
 
-	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
-
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
-
-		gdb_put_packet(connection, hex_buffer, pkt_len);
-
-		free(hex_buffer);
-	} else
+	/* TODO : Unless gdb_report_data_abort is set, we have to lie and send back
+	 * all zero's for unreadable memory lest stack traces won't work.
+	 * At some point this might be fixed in GDB, in which case this code can be removed.
+	 *
+	 * OpenOCD developers are acutely aware of this problem, but there is nothing
+	 * gained by involving the user in this problem that hopefully will get resolved
+	 * eventually
+	 *
+	 * http://sourceware.org/cgi-bin/gnatsweb.pl? \
+	 * cmd = view%20audit-trail&database = gdb&pr = 2395
+	 *
+	 * For now, the default is to fix up things to make current GDB versions work.
+	 * This can be overwritten using the gdb_report_data_abort <'enable'|'disable'> command.
+	 */
+	if (retval == ERROR_OK)
+		retval = gdb_put_memory_packet(connection, addr, len, buffer, valid,
+				binary, prefix);
+	else
 		retval = gdb_error(connection, retval);
 
 	free(buffer);
@@ -2616,6 +2753,9 @@ static int gdb_query_packet(struct connection *connection,
 			gdb_target_desc_supported = 0;
 		}
 
+		/* GDB prefixes binary 'x' replies with 'b' if it supports them */
+		gdb_connection->binary_upload = strstr(packet, "binary-upload+") != NULL;
+
 		/* support may be disabled globally */
 		if (gdb_use_target_description == 0) {
 			if (gdb_target_desc_supported)
@@ -2627,8 +2767,8 @@ static int gdb_query_packet(struct connection *connection,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
-			GDB_BUFFER_SIZE,
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+;binary-upload+",
+			gdb_connection->packet_size,
 			((gdb_use_memory_map == 1) && (flash_get_bank_count() > 0)) ? '+' : '-',
 			(gdb_target_desc_supported == 1) ? '+' : '-');
 
@@ -3198,14 +3338,12 @@ static void gdb_sig_halted(struct connection *connection)
 
 static int gdb_input_inner(struct connection *connection)
 {
-	/* Do not allocate this on the stack */
-	static char gdb_packet_buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for null-termination */
-
+	struct gdb_connection *gdb_con = connection->priv;
+	char *gdb_packet_buffer = gdb_con->packet_buffer;
 	struct target *target;
 	char const *packet = gdb_packet_buffer;
 	int packet_size;
 	int retval;
-	struct gdb_connection *gdb_con = connection->priv;
 	static bool warn_use_ext;
 
 	target = get_target_from_connection(connection);
@@ -3222,7 +3360,7 @@ static int gdb_input_inner(struct connection *connection)
 	 * drain the rest of the buffer.
 	 */
 	do {
-		packet_size = GDB_BUFFER_SIZE;
+		packet_size = gdb_con->packet_size;
 		retval = gdb_get_packet(connection, gdb_packet_buffer, &packet_size);
 		if (retval != ERROR_OK)
 			return retval;
@@ -3272,6 +3410,7 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_set_register_packet(connection, packet, packet_size);
 					break;
 				case 'm':
+				case 'x':
 					retval = gdb_read_memory_packet(connection, packet, packet_size);
 					break;
 				case 'M':
@@ -3476,6 +3615,7 @@ static int gdb_target_start(struct target *target, const char *port)
 	gdb_service->target = target;
 	gdb_service->core[0] = -1;
 	gdb_service->core[1] = -1;
+	gdb_service->connections = 0;
 	target->gdb_service = gdb_service;
 
 	ret = add_service("gdb",
@@ -3613,6 +3753,26 @@ COMMAND_HANDLER(handle_gdb_flash_program_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_packet_size_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		unsigned int size;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		if (size < GDB_BUFFER_SIZE || size > GDB_PACKET_SIZE_MAX) {
+			command_print(CMD, "packet size must be between %d and %d bytes",
+				GDB_BUFFER_SIZE, GDB_PACKET_SIZE_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		gdb_packet_size = size;
+	}
+
+	command_print(CMD, "%u", gdb_packet_size);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 {
 	if (CMD_ARGC != 1)
@@ -3745,6 +3905,14 @@ static const struct command_registration gdb_command_handlers[] = {
 		.help = "enable or disable flash program",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "gdb_packet_size",
+		.handler = handle_gdb_packet_size_command,
+		.mode = COMMAND_ANY,
+		.help = "Display or set the maximum packet size advertised to gdb. "
+			"Takes effect for new connections.",
+		.usage = "[size]"
+	},
 	{
 		.name = "gdb_report_data_abort",
 		.handler = handle_gdb_report_data_abort_command,
@@ -52,7 +52,8 @@ struct aarch64_private_config {
 };
 
 static int aarch64_poll(struct target *target);
-static int aarch64_debug_entry(struct target *target);
+static int aarch64_update_state(struct target *target, bool halted, bool lazy);
+static int aarch64_debug_entry(struct target *target, bool lazy);
 static int aarch64_restore_context(struct target *target, bool bpwp);
 static int aarch64_set_breakpoint(struct target *target,
 	struct breakpoint *breakpoint, uint8_t matchmode);
@@ -134,9 +135,14 @@ static int aarch64_mmu_modify(struct target *target, int enable)
 {
 	struct aarch64_common *aarch64 = target_to_aarch64(target);
 	struct armv8_common *armv8 = &aarch64->armv8_common;
-	int retval = ERROR_OK;
+	int retval;
 	uint32_t instr = 0;
 
+	/* X0, SCTLR and the core mode must have been saved before they change */
+	retval = armv8_dpm_read_deferred_context(&armv8->dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	if (enable) {
 		/*	if mmu enabled at target stop and mmu not enable */
 		if (!(aarch64->system_control_reg & 0x1U)) {
@@ -277,6 +283,20 @@ static int aarch64_set_dscr_bits(struct target *target, unsigned long bit_mask,
 	return armv8_set_dbgreg_bits(armv8, CPUV8_DBG_DSCR, bit_mask, value);
 }
 
+/*
+ * Make sure halting debug mode is enabled. While the PE is halted, DSCR
+ * as sampled on debug entry is still current, which saves a round trip.
+ */
+static int aarch64_enable_hde(struct target *target)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+
+	if (target->state == TARGET_HALTED && (armv8->dpm.dscr & DSCR_HDE))
+		return ERROR_OK;
+
+	return aarch64_set_dscr_bits(target, DSCR_HDE, DSCR_HDE);
+}
+
 static int aarch64_check_state_one(struct target *target,
 		uint32_t mask, uint32_t val, int *p_result, uint32_t *p_prsr)
 {
@@ -298,6 +318,111 @@ static int aarch64_check_state_one(struct target *target,
 	return ERROR_OK;
 }
 
+/*
+ * Run the queue of each DAP spanned by the examined PEs of the SMP group,
+ * except for the PE exclude, once.
+ */
+static int aarch64_dap_run_smp(struct target *target, struct target *exclude)
+{
+	struct target_list *head;
+	struct target_list *prev;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct adi_dap *dap = target_to_armv8(curr)->debug_ap->dap;
+		bool done = false;
+
+		if (curr == exclude)
+			continue;
+		if (!target_was_examined(curr))
+			continue;
+
+		foreach_smp_target(prev, target->head) {
+			if (prev == head)
+				break;
+			if (prev->target == exclude)
+				continue;
+			if (!target_was_examined(prev->target))
+				continue;
+			if (target_to_armv8(prev->target)->debug_ap->dap == dap) {
+				done = true;
+				break;
+			}
+		}
+		if (done)
+			continue;
+
+		int retval2 = dap_run(dap);
+		if (retval == ERROR_OK)
+			retval = retval2;
+	}
+
+	return retval;
+}
+
+/*
+ * Sample PRSR of all examined PEs in the SMP group. The reads are queued
+ * and each DAP spanned by the group is flushed only once, so checking the
+ * state of the whole group costs a single round trip per DAP instead of one
+ * per PE. The results are left in aarch64_common.prsr of each PE.
+ */
+static int aarch64_check_state_smp(struct target *target, bool exc_target)
+{
+	struct target_list *head;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->head) {
+		struct target *curr = head->target;
+		struct armv8_common *armv8 = target_to_armv8(curr);
+
+		if (exc_target && curr == target)
+			continue;
+		if (!target_was_examined(curr))
+			continue;
+
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_PRSR, &target_to_aarch64(curr)->prsr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return aarch64_dap_run_smp(target, exc_target ? target : NULL);
+}
+
+/*
+ * Breakpoint and watchpoint registers are written with queued accesses.
+ * breakpoints.c programs an SMP group one PE after the other, and all PEs
+ * allocate the same register pairs, so the queues are only run after the
+ * last examined PE of the group: setting or removing a breakpoint costs one
+ * round trip per DAP for the whole group. Writes left queued when the loop
+ * stops early are run by the next access to the DAP, before any PE resumes.
+ */
+static int aarch64_queue_bpwp_reg(struct target *target, unsigned int reg, uint32_t value)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+
+	return mem_ap_write_u32(armv8->debug_ap, armv8->debug_base + reg, value);
+}
+
+static int aarch64_flush_bpwp(struct target *target)
+{
+	struct target_list *head;
+	struct target *last = target;
+
+	if (!target->smp)
+		return dap_run(target_to_armv8(target)->debug_ap->dap);
+
+	foreach_smp_target(head, target->head) {
+		if (target_was_examined(head->target))
+			last = head->target;
+	}
+	if (last != target)
+		return ERROR_OK;
+
+	return aarch64_dap_run_smp(target, NULL);
+}
+
 static int aarch64_wait_halt_one(struct target *target)
 {
 	int retval = ERROR_OK;
@@ -418,18 +543,21 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 	for (;;) {
 		bool all_halted = true;
 		struct target_list *head;
-		struct target *curr;
+		struct target *curr = target;
 
-		foreach_smp_target(head, target->head) {
-			int halted;
+		retval = aarch64_check_state_smp(target, false);
+		if (retval != ERROR_OK)
+			all_halted = false;
 
+		foreach_smp_target(head, target->head) {
 			curr = head->target;
 
 			if (!target_was_examined(curr))
 				continue;
+			if (!all_halted)
+				break;
 
-			retval = aarch64_check_state_one(curr, PRSR_HALT, PRSR_HALT, &halted, NULL);
-			if (retval != ERROR_OK || !halted) {
+			if (!(target_to_aarch64(curr)->prsr & PRSR_HALT)) {
 				all_halted = false;
 				break;
 			}
@@ -463,12 +591,18 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
 	struct target *gdb_target = NULL;
 	struct target_list *head;
 	struct target *curr;
+	int retval;
 
 	if (debug_reason == DBG_REASON_NOTHALTED) {
 		LOG_DEBUG("Halting remaining targets in SMP group");
 		aarch64_halt_smp(target, true);
 	}
 
+	/* sample the state of the whole group in one go */
+	retval = aarch64_check_state_smp(target, true);
+	if (retval != ERROR_OK)
+		return retval;
+
 	/* poll all targets in the group, but skip the target that serves GDB */
 	foreach_smp_target(head, target->head) {
 		curr = head->target;
@@ -489,7 +623,7 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
 
 		/* avoid recursion in aarch64_poll() */
 		curr->smp = 0;
-		aarch64_poll(curr);
+		aarch64_update_state(curr, target_to_aarch64(curr)->prsr & PRSR_HALT, true);
 		curr->smp = 1;
 	}
 
@@ -504,16 +638,15 @@ static int update_halt_gdb(struct target *target, enum target_debug_reason debug
  * Aarch64 Run control
  */
 
-static int aarch64_poll(struct target *target)
+/*
+ * Update the target state from an already sampled PRSR.HALT. With lazy set,
+ * a debug entry only captures PC and CPSR; the rest of the context is read
+ * when first needed.
+ */
+static int aarch64_update_state(struct target *target, bool halted, bool lazy)
 {
 	enum target_state prev_target_state;
 	int retval = ERROR_OK;
-	int halted;
-
-	retval = aarch64_check_state_one(target,
-				PRSR_HALT, PRSR_HALT, &halted, NULL);
-	if (retval != ERROR_OK)
-		return retval;
 
 	if (halted) {
 		prev_target_state = target->state;
@@ -523,7 +656,7 @@ static int aarch64_poll(struct target *target)
 			/* We have a halting debug event */
 			target->state = TARGET_HALTED;
 			LOG_DEBUG("Target %s halted", target_name(target));
-			retval = aarch64_debug_entry(target);
+			retval = aarch64_debug_entry(target, lazy);
 			if (retval != ERROR_OK)
 				return retval;
 
@@ -552,6 +685,19 @@ static int aarch64_poll(struct target *target)
 	return retval;
 }
 
+static int aarch64_poll(struct target *target)
+{
+	int retval;
+	int halted;
+
+	retval = aarch64_check_state_one(target,
+				PRSR_HALT, PRSR_HALT, &halted, NULL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return aarch64_update_state(target, halted, false);
+}
+
 static int aarch64_halt(struct target *target)
 {
 	struct armv8_common *armv8 = target_to_armv8(target);
@@ -790,9 +936,12 @@ static int aarch64_step_restart_smp(struct target *target)
 		struct target *curr = target;
 		bool all_resumed = true;
 
+		retval = aarch64_check_state_smp(target, true);
+		if (retval != ERROR_OK)
+			all_resumed = false;
+
 		foreach_smp_target(head, target->head) {
 			uint32_t prsr;
-			int resumed;
 
 			curr = head->target;
 
@@ -802,9 +951,11 @@ static int aarch64_step_restart_smp(struct target *target)
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr,
-					PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-			if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
+			if (!all_resumed)
+				break;
+
+			prsr = target_to_aarch64(curr)->prsr;
+			if (!(prsr & PRSR_SDR) && (prsr & PRSR_HALT)) {
 				all_resumed = false;
 				break;
 			}
@@ -878,19 +1029,23 @@ static int aarch64_resume(struct target *target, int current,
 			struct target_list *head;
 			bool all_resumed = true;
 
+			retval = aarch64_check_state_smp(target, true);
+			if (retval != ERROR_OK)
+				all_resumed = false;
+
 			foreach_smp_target(head, target->head) {
 				uint32_t prsr;
-				int resumed;
 
 				curr = head->target;
 				if (curr == target)
 					continue;
 				if (!target_was_examined(curr))
 					continue;
+				if (!all_resumed)
+					break;
 
-				retval = aarch64_check_state_one(curr,
-						PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-				if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
+				prsr = target_to_aarch64(curr)->prsr;
+				if (!(prsr & PRSR_SDR) && (prsr & PRSR_HALT)) {
 					all_resumed = false;
 					break;
 				}
@@ -942,7 +1097,7 @@ static int aarch64_resume(struct target *target, int current,
 	return ERROR_OK;
 }
 
-static int aarch64_debug_entry(struct target *target)
+static int aarch64_debug_entry(struct target *target, bool lazy)
 {
 	int retval = ERROR_OK;
 	struct armv8_common *armv8 = target_to_armv8(target);
@@ -950,6 +1105,9 @@ static int aarch64_debug_entry(struct target *target)
 	enum arm_state core_state;
 	uint32_t dscr;
 
+	/* the PE ran, cached translations are stale */
+	armv8_mmu_tlb_invalidate(armv8);
+
 	/* make sure to clear all sticky errors */
 	retval = mem_ap_write_atomic_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
@@ -1002,6 +1160,12 @@ static int aarch64_debug_entry(struct target *target)
 		armv8_dpm_report_wfar(&armv8->dpm, wfar);
 	}
 
+	if (lazy) {
+		armv8->context_deferred = true;
+		return armv8_dpm_read_pc_cpsr(&armv8->dpm);
+	}
+
+	armv8->context_deferred = false;
 	retval = armv8_dpm_read_current_registers(&armv8->dpm);
 
 	if (retval == ERROR_OK && armv8->post_debug_entry)
@@ -1212,6 +1376,8 @@ static int aarch64_restore_context(struct target *target, bool bpwp)
 
 	retval = armv8_dpm_write_dirty_registers(&armv8->dpm, bpwp);
 	if (retval == ERROR_OK) {
+		/* a deferred context was never modified, nothing to fetch */
+		armv8->context_deferred = false;
 		/* registers are now invalid */
 		register_cache_invalidate(arm->core_cache);
 		register_cache_invalidate(arm->core_cache->next);
@@ -1261,19 +1427,19 @@ static int aarch64_set_breakpoint(struct target *target,
 		brp_list[brp_i].control = control;
 		bpt_value = brp_list[brp_i].value;
 
-		retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-				+ CPUV8_DBG_BVR_BASE + 16 * brp_list[brp_i].BRPn,
+		retval = aarch64_queue_bpwp_reg(target,
+				CPUV8_DBG_BVR_BASE + 16 * brp_list[brp_i].BRPn,
 				(uint32_t)(bpt_value & 0xFFFFFFFF));
 		if (retval != ERROR_OK)
 			return retval;
-		retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-				+ CPUV8_DBG_BVR_BASE + 4 + 16 * brp_list[brp_i].BRPn,
+		retval = aarch64_queue_bpwp_reg(target,
+				CPUV8_DBG_BVR_BASE + 4 + 16 * brp_list[brp_i].BRPn,
 				(uint32_t)(bpt_value >> 32));
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-				+ CPUV8_DBG_BCR_BASE + 16 * brp_list[brp_i].BRPn,
+		retval = aarch64_queue_bpwp_reg(target,
+				CPUV8_DBG_BCR_BASE + 16 * brp_list[brp_i].BRPn,
 				brp_list[brp_i].control);
 		if (retval != ERROR_OK)
 			return retval;
@@ -1337,12 +1503,15 @@ static int aarch64_set_breakpoint(struct target *target,
 	}
 
 	/* Ensure that halting debug mode is enable */
-	retval = aarch64_set_dscr_bits(target, DSCR_HDE, DSCR_HDE);
+	retval = aarch64_enable_hde(target);
 	if (retval != ERROR_OK) {
 		LOG_DEBUG("Failed to set DSCR.HDE");
 		return retval;
 	}
 
+	if (breakpoint->type == BKPT_HARD)
+		return aarch64_flush_bpwp(target);
+
 	return ERROR_OK;
 }
 
@@ -1563,24 +1732,24 @@ static int aarch64_unset_breakpoint(struct target *target, struct breakpoint *br
 			brp_list[brp_i].used = 0;
 			brp_list[brp_i].value = 0;
 			brp_list[brp_i].control = 0;
-			retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-					+ CPUV8_DBG_BCR_BASE + 16 * brp_list[brp_i].BRPn,
+			retval = aarch64_queue_bpwp_reg(target,
+					CPUV8_DBG_BCR_BASE + 16 * brp_list[brp_i].BRPn,
 					brp_list[brp_i].control);
 			if (retval != ERROR_OK)
 				return retval;
-			retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-					+ CPUV8_DBG_BVR_BASE + 16 * brp_list[brp_i].BRPn,
+			retval = aarch64_queue_bpwp_reg(target,
+					CPUV8_DBG_BVR_BASE + 16 * brp_list[brp_i].BRPn,
 					brp_list[brp_i].value);
 			if (retval != ERROR_OK)
 				return retval;
 
-			retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-					+ CPUV8_DBG_BVR_BASE + 4 + 16 * brp_list[brp_i].BRPn,
+			retval = aarch64_queue_bpwp_reg(target,
+					CPUV8_DBG_BVR_BASE + 4 + 16 * brp_list[brp_i].BRPn,
 					(uint32_t)brp_list[brp_i].value);
 			if (retval != ERROR_OK)
 				return retval;
 			breakpoint->set = 0;
-			return ERROR_OK;
+			return aarch64_flush_bpwp(target);
 		}
 	} else {
 		/* restore original instruction (kept in target endianness) */
@@ -1693,7 +1862,6 @@ static int aarch64_set_watchpoint(struct target *target,
 	int wp_i = 0;
 	uint32_t control, offset, length;
 	struct aarch64_common *aarch64 = target_to_aarch64(target);
-	struct armv8_common *armv8 = &aarch64->armv8_common;
 	struct aarch64_brp *wp_list = aarch64->wp_list;
 
 	if (watchpoint->set) {
@@ -1737,19 +1905,19 @@ static int aarch64_set_watchpoint(struct target *target,
 	wp_list[wp_i].value = watchpoint->address & 0xFFFFFFFFFFFFFFF8ULL;
 	wp_list[wp_i].control = control;
 
-	retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-			+ CPUV8_DBG_WVR_BASE + 16 * wp_list[wp_i].BRPn,
+	retval = aarch64_queue_bpwp_reg(target,
+			CPUV8_DBG_WVR_BASE + 16 * wp_list[wp_i].BRPn,
 			(uint32_t)(wp_list[wp_i].value & 0xFFFFFFFF));
 	if (retval != ERROR_OK)
 		return retval;
-	retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-			+ CPUV8_DBG_WVR_BASE + 4 + 16 * wp_list[wp_i].BRPn,
+	retval = aarch64_queue_bpwp_reg(target,
+			CPUV8_DBG_WVR_BASE + 4 + 16 * wp_list[wp_i].BRPn,
 			(uint32_t)(wp_list[wp_i].value >> 32));
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-			+ CPUV8_DBG_WCR_BASE + 16 * wp_list[wp_i].BRPn,
+	retval = aarch64_queue_bpwp_reg(target,
+			CPUV8_DBG_WCR_BASE + 16 * wp_list[wp_i].BRPn,
 			control);
 	if (retval != ERROR_OK)
 		return retval;
@@ -1757,7 +1925,7 @@ static int aarch64_set_watchpoint(struct target *target,
 		wp_list[wp_i].control, wp_list[wp_i].value);
 
 	/* Ensure that halting debug mode is enable */
-	retval = aarch64_set_dscr_bits(target, DSCR_HDE, DSCR_HDE);
+	retval = aarch64_enable_hde(target);
 	if (retval != ERROR_OK) {
 		LOG_DEBUG("Failed to set DSCR.HDE");
 		return retval;
@@ -1766,7 +1934,7 @@ static int aarch64_set_watchpoint(struct target *target,
 	wp_list[wp_i].used = 1;
 	watchpoint->set = wp_i + 1;
 
-	return ERROR_OK;
+	return aarch64_flush_bpwp(target);
 }
 
 /* Clear hardware Watchpoint Register Pair */
@@ -1775,7 +1943,6 @@ static int aarch64_unset_watchpoint(struct target *target,
 {
 	int retval, wp_i;
 	struct aarch64_common *aarch64 = target_to_aarch64(target);
-	struct armv8_common *armv8 = &aarch64->armv8_common;
 	struct aarch64_brp *wp_list = aarch64->wp_list;
 
 	if (!watchpoint->set) {
@@ -1793,25 +1960,25 @@ static int aarch64_unset_watchpoint(struct target *target,
 	wp_list[wp_i].used = 0;
 	wp_list[wp_i].value = 0;
 	wp_list[wp_i].control = 0;
-	retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-			+ CPUV8_DBG_WCR_BASE + 16 * wp_list[wp_i].BRPn,
+	retval = aarch64_queue_bpwp_reg(target,
+			CPUV8_DBG_WCR_BASE + 16 * wp_list[wp_i].BRPn,
 			wp_list[wp_i].control);
 	if (retval != ERROR_OK)
 		return retval;
-	retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-			+ CPUV8_DBG_WVR_BASE + 16 * wp_list[wp_i].BRPn,
+	retval = aarch64_queue_bpwp_reg(target,
+			CPUV8_DBG_WVR_BASE + 16 * wp_list[wp_i].BRPn,
 			wp_list[wp_i].value);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = aarch64_dap_write_memap_register_u32(target, armv8->debug_base
-			+ CPUV8_DBG_WVR_BASE + 4 + 16 * wp_list[wp_i].BRPn,
+	retval = aarch64_queue_bpwp_reg(target,
+			CPUV8_DBG_WVR_BASE + 4 + 16 * wp_list[wp_i].BRPn,
 			(uint32_t)wp_list[wp_i].value);
 	if (retval != ERROR_OK)
 		return retval;
 	watchpoint->set = 0;
 
-	return ERROR_OK;
+	return aarch64_flush_bpwp(target);
 }
 
 static int aarch64_add_watchpoint(struct target *target,
@@ -2061,6 +2228,11 @@ static int aarch64_write_cpu_memory(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* X0 and X1 get clobbered, make sure they were saved */
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	/* Mark register X0 as dirty, as it will be used
 	 * for transferring the data.
 	 * It will be restored automatically when exiting
@@ -2270,15 +2442,34 @@ static int aarch64_read_cpu_memory(struct target *target,
 	struct arm_dpm *dpm = &armv8->dpm;
 	struct arm *arm = &armv8->arm;
 	uint32_t dscr;
+	target_addr_t xfer_address = address;
+	uint32_t words = 0;
 
 	LOG_DEBUG("Reading CPU memory address 0x%16.16" PRIx64 " size %" PRIu32 " count %" PRIu32,
 			address, size, count);
 
+	/* Unaligned and sub-word block reads also use memory access mode: read
+	 * the aligned words covering the request and slice them on the host.
+	 * This never touches a word the request does not already overlap, so it
+	 * cannot cross into another page. Single element reads keep their access
+	 * width as they are likely to target a device register. */
+	if (size == 4 && (address % 4) == 0) {
+		words = count;
+	} else if (count > 1) {
+		xfer_address = address & ~(target_addr_t)3;
+		words = (address + size * count - xfer_address + 3) / 4;
+	}
+
 	if (target->state != TARGET_HALTED) {
 		LOG_WARNING("target not halted");
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* X0 and X1 get clobbered, make sure they were saved */
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	/* Mark register X0 as dirty, as it will be used
 	 * for transferring the data.
 	 * It will be restored automatically when exiting
@@ -2306,22 +2497,33 @@ static int aarch64_read_cpu_memory(struct target *target,
 		/* Step 1.a+b - Write the address for read access into DBGDTR_EL0 */
 		/* Step 1.c   - Copy value from DTR to R0 using instruction mrs DBGDTR_EL0, x0 */
 		retval = dpm->instr_write_data_dcc_64(dpm,
-				ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), address);
+				ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), xfer_address);
 	} else {
 		/* Write R0 with value 'address' using write procedure */
 		/* Step 1.a+b - Write the address for read access into DBGDTRRXint */
 		/* Step 1.c   - Copy value from DTR to R0 using instruction mrc DBGDTRTXint, r0 */
 		retval = dpm->instr_write_data_dcc(dpm,
-				ARMV4_5_MRC(14, 0, 0, 0, 5, 0), address);
+				ARMV4_5_MRC(14, 0, 0, 0, 5, 0), xfer_address);
 	}
 
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (size == 4 && (address % 4) == 0)
+	if (words && xfer_address == address && size == 4) {
 		retval = aarch64_read_cpu_memory_fast(target, count, buffer, &dscr);
-	else
+	} else if (words) {
+		uint8_t *words_buf = malloc(words * 4);
+		if (!words_buf) {
+			LOG_ERROR("Failed to allocate read buffer");
+			return ERROR_FAIL;
+		}
+		retval = aarch64_read_cpu_memory_fast(target, words, words_buf, &dscr);
+		if (retval == ERROR_OK)
+			memcpy(buffer, words_buf + (address - xfer_address), size * count);
+		free(words_buf);
+	} else {
 		retval = aarch64_read_cpu_memory_slow(target, size, count, buffer, &dscr);
+	}
 
 	if (dscr & DSCR_MA) {
 		dscr &= ~DSCR_MA;
@@ -2394,6 +2596,9 @@ static int aarch64_write_phys_memory(struct target *target,
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
+		/* the write may have changed the translation tables */
+		armv8_mmu_tlb_invalidate(target_to_armv8(target));
+
 		/* write memory through APB-AP */
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
@@ -2421,6 +2626,10 @@ static int aarch64_write_memory(struct target *target, target_addr_t address,
 		if (retval != ERROR_OK)
 			return retval;
 	}
+
+	/* the write may have changed the translation tables */
+	armv8_mmu_tlb_invalidate(target_to_armv8(target));
+
 	return aarch64_write_cpu_memory(target, address, size, count, buffer);
 }
 
@@ -2678,6 +2887,7 @@ static void aarch64_deinit_target(struct target *target)
 	struct arm_dpm *dpm = &armv8->dpm;
 
 	armv8_free_reg_cache(target);
+	free(armv8->armv8_mmu.tlb);
 	free(aarch64->brp_list);
 	free(dpm->dbp);
 	free(dpm->dwp);
@@ -2692,6 +2902,11 @@ static int aarch64_mmu(struct target *target, int *enabled)
 		return ERROR_TARGET_INVALID;
 	}
 
+	/* the MMU state is only known once SCTLR has been read */
+	int retval = armv8_dpm_read_deferred_context(&target_to_armv8(target)->dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	*enabled = target_to_aarch64(target)->armv8_common.armv8_mmu.mmu_enabled;
 	return ERROR_OK;
 }
@@ -2699,6 +2914,10 @@ static int aarch64_mmu(struct target *target, int *enabled)
 static int aarch64_virt2phys(struct target *target, target_addr_t virt,
 			     target_addr_t *phys)
 {
+	int retval = armv8_dpm_read_deferred_context(&target_to_armv8(target)->dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return armv8_mmu_translate_va_pa(target, virt, phys, 1);
 }
 
@@ -2801,6 +3020,13 @@ COMMAND_HANDLER(aarch64_handle_cache_info_command)
 	struct target *target = get_current_target(CMD_CTX);
 	struct armv8_common *armv8 = target_to_armv8(target);
 
+	/* caches are identified on the first full debug entry */
+	if (target->state == TARGET_HALTED) {
+		int retval = armv8_dpm_read_deferred_context(&armv8->dpm);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
 	return armv8_handle_cache_info_command(CMD,
 			&armv8->armv8_mmu.armv8_cache);
 }
@@ -3182,6 +3408,244 @@ COMMAND_HANDLER(aarch64_msr_mrs)
 	return retval;
 }
 
+/* EDDEVID.PCSample: EDPCSR is implemented in the external debug block */
+static bool aarch64_pcsr_supported(struct target *target)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	uint32_t devid;
+
+	if (mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_EDDEVID, &devid) != ERROR_OK)
+		return false;
+
+	return (devid & 0xf) >= 2;
+}
+
+/* drop the samples taken while the PE was halted, in reset or powered down */
+static uint32_t aarch64_pcsr_filter(uint32_t *samples, uint32_t count)
+{
+	uint32_t n = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (samples[i] != 0xffffffff)
+			samples[n++] = samples[i];
+	}
+
+	return n;
+}
+
+static int aarch64_profiling(struct target *target, uint32_t *samples,
+	uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct timeval timeout, now;
+	uint32_t sample_count = 0;
+	int retval = ERROR_OK;
+
+	if (!aarch64_pcsr_supported(target)) {
+		LOG_INFO("EDPCSR sampling not supported on this processor.");
+		return target_profiling_default(target, samples, max_num_samples, num_samples, seconds);
+	}
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	LOG_INFO("Starting aarch64 profiling. Sampling EDPCSR as fast as we can...");
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED)
+		retval = target_resume(target, 1, 0, 0, 0);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error while resuming target");
+		return retval;
+	}
+
+	for (;;) {
+		uint32_t read_count = MIN(max_num_samples - sample_count, 1024);
+
+		/* every read of EDPCSRlo takes a new sample */
+		retval = mem_ap_read_buf_noincr(armv8->debug_ap,
+					(void *)&samples[sample_count], 4, read_count,
+					armv8->debug_base + CPUV8_DBG_EDPCSR);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading EDPCSR");
+			return retval;
+		}
+		sample_count += aarch64_pcsr_filter(&samples[sample_count], read_count);
+
+		gettimeofday(&now, NULL);
+		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
+			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+			break;
+		}
+	}
+
+	*num_samples = sample_count;
+	return retval;
+}
+
+#define AARCH64_PCSR_PROFILE_MAX_SAMPLES	100000
+#define AARCH64_PCSR_PROFILE_BATCH		64
+
+struct aarch64_pcsr_profile {
+	struct target *target;
+	uint32_t *samples;
+	uint32_t num_samples;
+	uint32_t queued;
+	uint32_t raw[AARCH64_PCSR_PROFILE_BATCH];
+};
+
+COMMAND_HANDLER(aarch64_handle_pcsr_profile_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct aarch64_pcsr_profile *pes;
+	struct target_list *head;
+	struct timeval timeout, now;
+	unsigned int num_pes = 0, max_pes = 1;
+	uint32_t seconds;
+	int retval = ERROR_OK;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], seconds);
+
+	if (target->smp) {
+		max_pes = 0;
+		foreach_smp_target(head, target->head)
+			max_pes++;
+	}
+
+	pes = calloc(max_pes, sizeof(*pes));
+	if (!pes) {
+		LOG_ERROR("No memory to store samples.");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < max_pes; i++) {
+		struct target *curr = target;
+
+		if (target->smp) {
+			head = target->head;
+			for (unsigned int j = 0; j < i; j++)
+				head = head->next;
+			curr = head->target;
+		}
+
+		if (!target_was_examined(curr) || !aarch64_pcsr_supported(curr)) {
+			LOG_WARNING("%s: EDPCSR sampling not available, skipped", target_name(curr));
+			continue;
+		}
+
+		pes[num_pes].target = curr;
+		pes[num_pes].samples = malloc(AARCH64_PCSR_PROFILE_MAX_SAMPLES * sizeof(uint32_t));
+		if (!pes[num_pes].samples) {
+			LOG_ERROR("No memory to store samples.");
+			retval = ERROR_FAIL;
+			goto out;
+		}
+		num_pes++;
+	}
+
+	if (!num_pes) {
+		retval = ERROR_FAIL;
+		goto out;
+	}
+
+	uint64_t timestart_ms = timeval_ms();
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	/*
+	 * Sample all PEs without stopping them: queue a batch of EDPCSR reads
+	 * on every PE, then flush each DAP involved once.
+	 */
+	for (bool done = false; !done; ) {
+		done = true;
+
+		for (unsigned int i = 0; i < num_pes && retval == ERROR_OK; i++) {
+			struct armv8_common *armv8 = target_to_armv8(pes[i].target);
+
+			pes[i].queued = MIN(AARCH64_PCSR_PROFILE_BATCH,
+				AARCH64_PCSR_PROFILE_MAX_SAMPLES - pes[i].num_samples);
+			for (uint32_t k = 0; k < pes[i].queued && retval == ERROR_OK; k++)
+				retval = mem_ap_read_u32(armv8->debug_ap,
+						armv8->debug_base + CPUV8_DBG_EDPCSR, &pes[i].raw[k]);
+		}
+
+		for (unsigned int i = 0; i < num_pes; i++) {
+			struct adi_dap *dap = target_to_armv8(pes[i].target)->debug_ap->dap;
+			bool flushed = false;
+
+			for (unsigned int j = 0; j < i; j++)
+				flushed |= target_to_armv8(pes[j].target)->debug_ap->dap == dap;
+
+			if (!flushed) {
+				int retval2 = dap_run(dap);
+				if (retval == ERROR_OK)
+					retval = retval2;
+			}
+		}
+
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading EDPCSR");
+			goto out;
+		}
+
+		for (unsigned int i = 0; i < num_pes; i++) {
+			uint32_t n = aarch64_pcsr_filter(pes[i].raw, pes[i].queued);
+
+			memcpy(&pes[i].samples[pes[i].num_samples], pes[i].raw, n * sizeof(uint32_t));
+			pes[i].num_samples += n;
+			if (pes[i].num_samples < AARCH64_PCSR_PROFILE_MAX_SAMPLES)
+				done = false;
+		}
+
+		gettimeofday(&now, NULL);
+		if (timeval_compare(&now, &timeout) > 0)
+			done = true;
+	}
+
+	uint32_t duration_ms = timeval_ms() - timestart_ms;
+
+	for (unsigned int i = 0; i < num_pes; i++) {
+		uint32_t *samples = pes[i].samples;
+		uint32_t min = UINT32_MAX, max = 0;
+		char *filename;
+
+		if (!pes[i].num_samples) {
+			command_print(CMD, "%s: no samples, PE not running", target_name(pes[i].target));
+			continue;
+		}
+
+		for (uint32_t k = 0; k < pes[i].num_samples; k++) {
+			min = MIN(min, samples[k]);
+			max = MAX(max, samples[k]);
+		}
+
+		filename = alloc_printf("%s.%s", CMD_ARGV[1], target_name(pes[i].target));
+		if (!filename) {
+			retval = ERROR_FAIL;
+			goto out;
+		}
+
+		/* gmon needs a histogram range of at least two bytes */
+		target_write_gmon(samples, pes[i].num_samples, filename,
+			max - min < 2, min, min + 2, pes[i].target, duration_ms);
+		command_print(CMD, "Wrote %s, %" PRIu32 " samples", filename, pes[i].num_samples);
+		free(filename);
+	}
+
+out:
+	for (unsigned int i = 0; i < max_pes; i++)
+		free(pes[i].samples);
+	free(pes);
+
+	return retval;
+}
+
 static const struct command_registration aarch64_exec_command_handlers[] = {
 	{
 		.name = "cache_info",
@@ -3204,6 +3668,14 @@ static const struct command_registration aarch64_exec_command_handlers[] = {
 		.help = "Disassemble instructions",
 		.usage = "address [count]",
 	},
+	{
+		.name = "pcsr_profile",
+		.handler = aarch64_handle_pcsr_profile_command,
+		.mode = COMMAND_EXEC,
+		.help = "sample the PC of all PEs of the SMP group through EDPCSR "
+			"and write one gmon file per PE",
+		.usage = "seconds filename_prefix",
+	},
 	{
 		.name = "maskisr",
 		.handler = aarch64_mask_interrupts_command,
@@ -3297,6 +3769,10 @@ struct target_type aarch64_target = {
 
 	.read_memory = aarch64_read_memory,
 	.write_memory = aarch64_write_memory,
+	.checksum_memory = armv8_checksum_memory,
+	.blank_check_memory = armv8_blank_check_memory,
+
+	.run_algorithm = armv8_run_algorithm,
 
 	.add_breakpoint = aarch64_add_breakpoint,
 	.add_context_breakpoint = aarch64_add_context_breakpoint,
@@ -3317,4 +3793,6 @@ struct target_type aarch64_target = {
 	.write_phys_memory = aarch64_write_phys_memory,
 	.mmu = aarch64_mmu,
 	.virt2phys = aarch64_virt2phys,
+
+	.profiling = aarch64_profiling,
 };
@@ -79,6 +79,9 @@ struct aarch64_common {
 	enum aarch64_isrmasking_mode isrmasking_mode;
 
 	enum aarch64_steponly_mode step_only_mode;
+
+	/* PRSR value sampled by the last batched SMP state check */
+	uint32_t prsr;
 };
 
 static inline struct aarch64_common *
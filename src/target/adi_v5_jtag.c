@@ -492,6 +492,7 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 						retval = ERROR_JTAG_DEVICE_ERROR;
 						break;
 					}
+					dap->perf.waits++;
 
 				} while (timeval_ms() - time_now < 1000);
 
@@ -526,6 +527,8 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 	/* move all remaining transactions over to the replay list */
 	list_for_each_entry_safe_from(el, tmp, &dap->cmd_journal, lh) {
 		log_dap_cmd("REP", el);
+		if (el->ack == JTAG_ACK_WAIT)
+			dap->perf.waits++;
 		list_move_tail(&el->lh, &replay_list);
 	}
 
@@ -576,6 +579,7 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 					retval = ERROR_JTAG_DEVICE_ERROR;
 					break;
 				}
+				dap->perf.waits++;
 			} while (timeval_ms() - time_now < 1000);
 
 			if (retval == ERROR_OK) {
@@ -157,7 +157,6 @@ static const char *dap_reg_name(int instr, int reg_addr)
 #endif
 
 struct dap_cmd {
-	struct list_head lh;
 	uint8_t instr;
 	unsigned reg_addr;
 	uint8_t RnW;
@@ -165,6 +164,8 @@ struct dap_cmd {
 	uint8_t ack;
 	uint32_t memaccess_tck;
 	uint64_t dp_select;
+	/* AP of an APACC transaction, for memaccess_tck tuning */
+	struct adi_ap *ap;
 
 	struct scan_field fields[2];
 	uint8_t out_addr_buf;
@@ -172,12 +173,21 @@ struct dap_cmd {
 	uint8_t outvalue_buf[4];
 };
 
-#define MAX_DAP_COMMAND_NUM 65536
+/* Commands are kept in a preallocated ring per DAP. The journal used for
+ * WAIT recovery is the range [cmd_ring_head, cmd_ring_tail) of free running
+ * indices; the ring is flushed by dap_run() well before it can fill up. */
+#define DAP_CMD_RING_SIZE 16384
+#define DAP_CMD_RING_RESERVE 16
 
-struct dap_cmd_pool {
-	struct list_head lh;
-	struct dap_cmd cmd;
-} dap_cmd_pool;
+#define dap_cmd_ring_entry(dap, idx) (&(dap)->cmd_ring[(idx) & (DAP_CMD_RING_SIZE - 1)])
+
+/* Batches replayed after WAIT before falling back to one scan at a time */
+#define JTAGDP_MAX_REPLAYS 4
+
+/* Upper limit of the tuned memaccess_tck */
+#define JTAGDP_MEMACCESS_TCK_MAX 255
+/* AP transactions without WAIT before memaccess_tck is lowered again */
+#define JTAGDP_MEMACCESS_CLEAN 4096
 
 static void log_dap_cmd(const char *header, struct dap_cmd *el)
 {
@@ -195,33 +205,19 @@ static void log_dap_cmd(const char *header, struct dap_cmd *el)
 
 static int jtag_limit_queue_size(struct adi_dap *dap)
 {
-	if (dap->cmd_pool_size < MAX_DAP_COMMAND_NUM)
+	/* keep some room for the few commands a single queued access and
+	 * the WAIT recovery may add */
+	if (dap->cmd_ring_tail - dap->cmd_ring_head < DAP_CMD_RING_SIZE - DAP_CMD_RING_RESERVE)
 		return ERROR_OK;
 
 	return dap_run(dap);
 }
 
-static struct dap_cmd *dap_cmd_new(struct adi_dap *dap, uint8_t instr,
+static void dap_cmd_init(struct dap_cmd *cmd, uint8_t instr,
 		unsigned reg_addr, uint8_t RnW,
 		uint8_t *outvalue, uint8_t *invalue,
 		uint32_t memaccess_tck)
 {
-	struct dap_cmd_pool *pool = NULL;
-
-	if (list_empty(&dap->cmd_pool)) {
-		pool = calloc(1, sizeof(struct dap_cmd_pool));
-		if (pool == NULL)
-			return NULL;
-	} else {
-		pool = list_first_entry(&dap->cmd_pool, struct dap_cmd_pool, lh);
-		list_del(&pool->lh);
-	}
-
-	INIT_LIST_HEAD(&pool->lh);
-	dap->cmd_pool_size++;
-
-	struct dap_cmd *cmd = &pool->cmd;
-	INIT_LIST_HEAD(&cmd->lh);
 	cmd->instr = instr;
 	cmd->reg_addr = reg_addr;
 	cmd->RnW = RnW;
@@ -229,40 +225,42 @@ static struct dap_cmd *dap_cmd_new(struct adi_dap *dap, uint8_t instr,
 		memcpy(cmd->outvalue_buf, outvalue, 4);
 	cmd->invalue = (invalue != NULL) ? invalue : cmd->invalue_buf;
 	cmd->memaccess_tck = memaccess_tck;
-
-	return cmd;
+	cmd->ap = NULL;
 }
 
-static void dap_cmd_release(struct adi_dap *dap, struct dap_cmd *cmd)
+static struct dap_cmd *dap_cmd_new(struct adi_dap *dap, uint8_t instr,
+		unsigned reg_addr, uint8_t RnW,
+		uint8_t *outvalue, uint8_t *invalue,
+		uint32_t memaccess_tck)
 {
-	struct dap_cmd_pool *pool = container_of(cmd, struct dap_cmd_pool, cmd);
-	if (dap->cmd_pool_size > MAX_DAP_COMMAND_NUM)
-		free(pool);
-	else
-		list_add(&pool->lh, &dap->cmd_pool);
+	if (dap->cmd_ring == NULL) {
+		dap->cmd_ring = calloc(DAP_CMD_RING_SIZE, sizeof(struct dap_cmd));
+		if (dap->cmd_ring == NULL)
+			return NULL;
+	}
 
-	dap->cmd_pool_size--;
+	if (dap->cmd_ring_tail - dap->cmd_ring_head >= DAP_CMD_RING_SIZE) {
+		LOG_ERROR("DAP command queue overflow");
+		return NULL;
+	}
+
+	struct dap_cmd *cmd = dap_cmd_ring_entry(dap, dap->cmd_ring_tail);
+	dap_cmd_init(cmd, instr, reg_addr, RnW, outvalue, invalue, memaccess_tck);
+
+	return cmd;
 }
 
-static void flush_journal(struct adi_dap *dap, struct list_head *lh)
+static void flush_journal(struct adi_dap *dap)
 {
-	struct dap_cmd *el, *tmp;
-
-	list_for_each_entry_safe(el, tmp, lh, lh) {
-		list_del(&el->lh);
-		dap_cmd_release(dap, el);
-	}
+	dap->cmd_ring_head = dap->cmd_ring_tail;
 }
 
 static void jtag_quit(struct adi_dap *dap)
 {
-	struct dap_cmd_pool *el, *tmp;
-	struct list_head *lh = &dap->cmd_pool;
-
-	list_for_each_entry_safe(el, tmp, lh, lh) {
-		list_del(&el->lh);
-		free(el);
-	}
+	free(dap->cmd_ring);
+	dap->cmd_ring = NULL;
+	dap->cmd_ring_head = 0;
+	dap->cmd_ring_tail = 0;
 }
 
 /***************************************************************************
@@ -361,7 +359,7 @@ static int adi_jtag_dp_scan(struct adi_dap *dap,
 
 	retval = adi_jtag_dp_scan_cmd(dap, cmd, ack);
 	if (retval == ERROR_OK)
-		list_add_tail(&cmd->lh,	&dap->cmd_journal);
+		dap->cmd_ring_tail++;
 
 	return retval;
 }
@@ -447,13 +445,119 @@ static int adi_jtag_scan_inout_check_u32(struct adi_dap *dap,
 	return jtag_execute_queue();
 }
 
+/* An AP transaction completed without WAIT; after a long enough run of
+ * them, try with fewer idle cycles. */
+static void jtagdp_memaccess_clean(struct adi_ap *ap)
+{
+	if (!ap->memaccess_auto || ++ap->memaccess_clean < JTAGDP_MEMACCESS_CLEAN)
+		return;
+
+	ap->memaccess_clean = 0;
+	if (ap->memaccess_tck > ap->memaccess_tck_min) {
+		ap->memaccess_tck -= (ap->memaccess_tck - ap->memaccess_tck_min + 7) / 8;
+		LOG_DEBUG("AP #%d memaccess_tck lowered to %" PRIu32,
+				ap->ap_num, ap->memaccess_tck);
+	}
+}
+
+/* The transaction at wait_idx was answered with WAIT: give the AP that was
+ * accessed last more idle cycles to complete its accesses. */
+static void jtagdp_memaccess_stalled(struct adi_dap *dap, unsigned int wait_idx)
+{
+	struct adi_ap *ap;
+	unsigned int idx = wait_idx;
+
+	for (;;) {
+		ap = dap_cmd_ring_entry(dap, idx)->ap;
+		if (ap != NULL || idx == dap->cmd_ring_head)
+			break;
+		idx--;
+	}
+
+	if (ap == NULL || !ap->memaccess_auto)
+		return;
+
+	ap->memaccess_clean = 0;
+	if (ap->memaccess_tck < JTAGDP_MEMACCESS_TCK_MAX) {
+		ap->memaccess_tck = MIN(ap->memaccess_tck + ap->memaccess_tck / 2 + 4,
+				JTAGDP_MEMACCESS_TCK_MAX);
+		LOG_DEBUG("DAP transaction stalled (WAIT) - AP #%d memaccess_tck raised to %" PRIu32,
+				ap->ap_num, ap->memaccess_tck);
+	}
+}
+
+/* Queue the journaled transactions [start, end) again as a new batch, with
+ * the current memaccess_tck of their AP. The journal must be empty. */
+static int jtagdp_requeue(struct adi_dap *dap, unsigned int start, unsigned int end)
+{
+	int retval;
+
+	for (unsigned int idx = start; idx != end; idx++) {
+		struct dap_cmd *el = dap_cmd_ring_entry(dap, idx);
+		struct dap_cmd *cmd = dap_cmd_ring_entry(dap, dap->cmd_ring_tail);
+
+		*cmd = *el;
+		if (el->invalue == el->invalue_buf)
+			cmd->invalue = cmd->invalue_buf;
+		if (cmd->ap != NULL)
+			cmd->memaccess_tck = cmd->ap->memaccess_tck;
+
+		retval = adi_jtag_dp_scan_cmd(dap, cmd, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+		dap->cmd_ring_tail++;
+
+		if (cmd->invalue != cmd->invalue_buf)
+			jtag_add_callback(arm_le_to_h_u32,
+					(jtag_callback_data_t) cmd->invalue);
+	}
+
+	return ERROR_OK;
+}
+
+/* Synchronously rescan cmd until it is no longer answered with WAIT. */
+static int jtagdp_retry_cmd(struct adi_dap *dap, struct dap_cmd *cmd, const char *header)
+{
+	int retval;
+	int64_t time_now = timeval_ms();
+
+	do {
+		retval = adi_jtag_dp_scan_cmd_sync(dap, cmd, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+		log_dap_cmd(header, cmd);
+		if (cmd->ack == JTAG_ACK_OK || cmd->ack == JTAG_ACK_FAULT)
+			return ERROR_OK;
+		if (cmd->ack != JTAG_ACK_WAIT) {
+			LOG_ERROR("Invalid ACK (%1x) in DAP response", cmd->ack);
+			log_dap_cmd("ERR", cmd);
+			return ERROR_JTAG_DEVICE_ERROR;
+		}
+		dap->perf.waits++;
+	} while (timeval_ms() - time_now < 1000);
+
+	LOG_ERROR("Timeout during WAIT recovery");
+	dap->select = DP_SELECT_INVALID;
+	jtag_ap_q_abort(dap, NULL);
+	/* clear the sticky overrun condition */
+	adi_jtag_scan_inout_check_u32(dap, JTAG_DP_DPACC,
+		DP_CTRL_STAT, DPAP_WRITE,
+		dap->dp_ctrl_stat | SSTICKYORUN, NULL, 0);
+	return ERROR_JTAG_DEVICE_ERROR;
+}
+
 static int jtagdp_overrun_check(struct adi_dap *dap)
 {
 	int retval;
-	struct dap_cmd *el, *tmp, *prev = NULL;
-	int found_wait = 0;
-	int64_t time_now;
-	LIST_HEAD(replay_list);
+	struct dap_cmd *el, *tmp;
+	struct dap_cmd recover;
+	unsigned int idx, wait_idx;
+	unsigned int replay_end;
+	unsigned int replays = 0;
+	int found_wait;
+
+ again:
+	found_wait = 0;
 
 	/* make sure all queued transactions are complete */
 	retval = jtag_execute_queue();
@@ -461,11 +565,15 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 		goto done;
 
 	/* skip all completed transactions up to the first WAIT */
-	list_for_each_entry(el, &dap->cmd_journal, lh) {
+	for (idx = dap->cmd_ring_head; idx != dap->cmd_ring_tail; idx++) {
+		el = dap_cmd_ring_entry(dap, idx);
 		if (el->ack == JTAG_ACK_OK || el->ack == JTAG_ACK_FAULT) {
 			log_dap_cmd("LOG", el);
+			if (el->ap != NULL)
+				jtagdp_memaccess_clean(el->ap);
 		} else if (el->ack == JTAG_ACK_WAIT) {
 			found_wait = 1;
+			jtagdp_memaccess_stalled(dap, idx);
 			break;
 		} else {
 			LOG_ERROR("Invalid ACK (%1x) in DAP response", el->ack);
@@ -474,19 +582,22 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 			goto done;
 		}
 	}
+	wait_idx = idx;
+	replay_end = dap->cmd_ring_tail;
 
 	/*
 	 * If we found a stalled transaction and a previous transaction
 	 * exists, check if it's a READ access.
 	 */
-	if (found_wait && el != list_first_entry(&dap->cmd_journal, struct dap_cmd, lh)) {
-		prev = list_entry(el->lh.prev, struct dap_cmd, lh);
+	if (found_wait && wait_idx != dap->cmd_ring_head) {
+		el = dap_cmd_ring_entry(dap, wait_idx);
+		struct dap_cmd *prev = dap_cmd_ring_entry(dap, wait_idx - 1);
 		if (prev->RnW == DPAP_READ) {
 			log_dap_cmd("PND", prev);
 			/* search for the next OK transaction, it contains
 			 * the result of the previous READ */
-			tmp = el;
-			list_for_each_entry_from(tmp, &dap->cmd_journal, lh) {
+			for (idx = wait_idx; idx != replay_end; idx++) {
+				tmp = dap_cmd_ring_entry(dap, idx);
 				if (tmp->ack == JTAG_ACK_OK || tmp->ack == JTAG_ACK_FAULT) {
 					/* recover the read value */
 					log_dap_cmd("FND", tmp);
@@ -510,55 +621,16 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 				* To complete the READ, we just keep polling RDBUFF
 				* until the WAIT condition clears
 				*/
-				tmp = dap_cmd_new(dap, JTAG_DP_DPACC,
+				dap_cmd_init(&recover, JTAG_DP_DPACC,
 						DP_RDBUFF, DPAP_READ, NULL, NULL, 0);
-				if (tmp == NULL) {
-					retval = ERROR_JTAG_DEVICE_ERROR;
-					goto done;
-				}
-				/* synchronously retry the command until it succeeds */
-				time_now = timeval_ms();
-				do {
-					retval = adi_jtag_dp_scan_cmd_sync(dap, tmp, NULL);
-					if (retval != ERROR_OK)
-						break;
-					if (tmp->ack == JTAG_ACK_OK || tmp->ack == JTAG_ACK_FAULT) {
-						log_dap_cmd("FND", tmp);
-						if (el->invalue != el->invalue_buf) {
-							uint32_t invalue = le_to_h_u32(tmp->invalue);
-							memcpy(el->invalue, &invalue, sizeof(uint32_t));
-						}
-						break;
-					}
-					if (tmp->ack != JTAG_ACK_WAIT) {
-						LOG_ERROR("Invalid ACK (%1x) in DAP response", tmp->ack);
-						log_dap_cmd("ERR", tmp);
-						retval = ERROR_JTAG_DEVICE_ERROR;
-						break;
-					}
-
-				} while (timeval_ms() - time_now < 1000);
-
-				if (retval == ERROR_OK) {
-					/* timeout happened */
-					if (tmp->ack == JTAG_ACK_WAIT) {
-						LOG_ERROR("Timeout during WAIT recovery");
-						dap->select = DP_SELECT_INVALID;
-						jtag_ap_q_abort(dap, NULL);
-						/* clear the sticky overrun condition */
-						adi_jtag_scan_inout_check_u32(dap, JTAG_DP_DPACC,
-							DP_CTRL_STAT, DPAP_WRITE,
-							dap->dp_ctrl_stat | SSTICKYORUN, NULL, 0);
-						retval = ERROR_JTAG_DEVICE_ERROR;
-					}
-				}
-
-				/* we're done with this command, release it */
-				dap_cmd_release(dap, tmp);
-
+				retval = jtagdp_retry_cmd(dap, &recover, "FND");
 				if (retval != ERROR_OK)
 					goto done;
 
+				if (el->invalue != el->invalue_buf) {
+					uint32_t invalue = le_to_h_u32(recover.invalue);
+					memcpy(el->invalue, &invalue, sizeof(uint32_t));
+				}
 			}
 			/* make el->invalue point to the default invalue
 			* so that we can safely retry it without clobbering
@@ -567,18 +639,20 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 		}
 	}
 
-	/* move all remaining transactions over to the replay list */
-	list_for_each_entry_safe_from(el, tmp, &dap->cmd_journal, lh) {
+	/* The remaining transactions [wait_idx, replay_end) are replayed;
+	 * detach them from the journal so the recovery scans below are
+	 * journaled after them. */
+	for (idx = wait_idx; idx != replay_end; idx++) {
+		el = dap_cmd_ring_entry(dap, idx);
 		log_dap_cmd("REP", el);
-		list_move_tail(&el->lh, &replay_list);
+		if (el->ack == JTAG_ACK_WAIT)
+			dap->perf.waits++;
 	}
-
-	/* we're done with the journal, flush it */
-	flush_journal(dap, &dap->cmd_journal);
+	flush_journal(dap);
 
 	/* check for overrun condition in the last batch of transactions */
 	if (found_wait) {
-		LOG_INFO("DAP transaction stalled (WAIT) - slowing down");
+		LOG_DEBUG("DAP transaction stalled (WAIT) - replaying");
 		/* clear the sticky overrun condition */
 		retval = adi_jtag_scan_inout_check_u32(dap, JTAG_DP_DPACC,
 				DP_CTRL_STAT, DPAP_WRITE,
@@ -587,61 +661,41 @@ static int jtagdp_overrun_check(struct adi_dap *dap)
 			goto done;
 
 		/* restore SELECT register first */
-		if (!list_empty(&replay_list)) {
-			el = list_first_entry(&replay_list, struct dap_cmd, lh);
-			tmp = dap_cmd_new(dap, JTAG_DP_DPACC,
-					  DP_SELECT, DPAP_WRITE, (uint8_t *)&el->dp_select, NULL, 0);
-			if (tmp == NULL) {
-				retval = ERROR_JTAG_DEVICE_ERROR;
+		if (wait_idx != replay_end) {
+			el = dap_cmd_ring_entry(dap, wait_idx);
+			dap_cmd_init(&recover, JTAG_DP_DPACC,
+					DP_SELECT, DPAP_WRITE, (uint8_t *)&el->dp_select, NULL, 0);
+			dap->select = DP_SELECT_INVALID;
+			retval = jtagdp_retry_cmd(dap, &recover, "REC");
+			if (retval != ERROR_OK)
 				goto done;
-			}
-			list_add(&tmp->lh, &replay_list);
+		}
 
-			dap->select = DP_SELECT_INVALID;
+		/* replay the stalled transactions as one batch and check it
+		 * like the original one, now with more idle cycles */
+		if (replays < JTAGDP_MAX_REPLAYS) {
+			replays++;
+			flush_journal(dap);
+			retval = jtagdp_requeue(dap, wait_idx, replay_end);
+			if (retval != ERROR_OK)
+				goto done;
+			goto again;
 		}
 
-		list_for_each_entry_safe(el, tmp, &replay_list, lh) {
-			time_now = timeval_ms();
-			do {
-				retval = adi_jtag_dp_scan_cmd_sync(dap, el, NULL);
-				if (retval != ERROR_OK)
-					break;
-				log_dap_cmd("REC", el);
-				if (el->ack == JTAG_ACK_OK || el->ack == JTAG_ACK_FAULT) {
-					if (el->invalue != el->invalue_buf) {
-						uint32_t invalue = le_to_h_u32(el->invalue);
-						memcpy(el->invalue, &invalue, sizeof(uint32_t));
-					}
-					break;
-				}
-				if (el->ack != JTAG_ACK_WAIT) {
-					LOG_ERROR("Invalid ACK (%1x) in DAP response", el->ack);
-					log_dap_cmd("ERR", el);
-					retval = ERROR_JTAG_DEVICE_ERROR;
-					break;
-				}
-			} while (timeval_ms() - time_now < 1000);
-
-			if (retval == ERROR_OK) {
-				if (el->ack == JTAG_ACK_WAIT) {
-					LOG_ERROR("Timeout during WAIT recovery");
-					dap->select = DP_SELECT_INVALID;
-					jtag_ap_q_abort(dap, NULL);
-					/* clear the sticky overrun condition */
-					adi_jtag_scan_inout_check_u32(dap, JTAG_DP_DPACC,
-						DP_CTRL_STAT, DPAP_WRITE,
-						dap->dp_ctrl_stat | SSTICKYORUN, NULL, 0);
-					retval = ERROR_JTAG_DEVICE_ERROR;
-					break;
-				}
-			} else
+		for (idx = wait_idx; idx != replay_end; idx++) {
+			el = dap_cmd_ring_entry(dap, idx);
+			retval = jtagdp_retry_cmd(dap, el, "REC");
+			if (retval != ERROR_OK)
 				break;
+			if (el->invalue != el->invalue_buf) {
+				uint32_t invalue = le_to_h_u32(el->invalue);
+				memcpy(el->invalue, &invalue, sizeof(uint32_t));
+			}
 		}
 	}
 
  done:
-	flush_journal(dap, &replay_list);
-	flush_journal(dap, &dap->cmd_journal);
+	flush_journal(dap);
 	return retval;
 }
 
@@ -690,7 +744,7 @@ static int jtagdp_transaction_endcheck(struct adi_dap *dap)
 	}
 
  done:
-	flush_journal(dap, &dap->cmd_journal);
+	flush_journal(dap);
 	return retval;
 }
 
@@ -798,6 +852,8 @@ static int jtag_ap_q_read(struct adi_ap *ap, unsigned reg,
 
 	retval =  adi_jtag_dp_scan_u32(ap->dap, JTAG_DP_APACC, reg,
 			DPAP_READ, 0, ap->dap->last_read, ap->memaccess_tck, NULL);
+	if (retval == ERROR_OK)
+		dap_cmd_ring_entry(ap->dap, ap->dap->cmd_ring_tail - 1)->ap = ap;
 	ap->dap->last_read = data;
 
 	return retval;
@@ -820,6 +876,8 @@ static int jtag_ap_q_write(struct adi_ap *ap, unsigned reg,
 
 	retval =  adi_jtag_dp_scan_u32(ap->dap, JTAG_DP_APACC, reg,
 			DPAP_WRITE, data, ap->dap->last_read, ap->memaccess_tck, NULL);
+	if (retval == ERROR_OK)
+		dap_cmd_ring_entry(ap->dap, ap->dap->cmd_ring_tail - 1)->ap = ap;
 	ap->dap->last_read = NULL;
 	return retval;
 }
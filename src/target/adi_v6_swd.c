@@ -88,6 +88,10 @@ static int swd_run_inner(struct adi_dap *dap)
 
 	retval = swd->run();
 
+	/* a transaction the SWD driver gave up retrying on WAIT */
+	if (retval == ERROR_WAIT)
+		dap->perf.waits++;
+
 	if (retval != ERROR_OK) {
 		/* fault response */
 		dap->do_reconnect = true;
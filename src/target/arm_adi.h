@@ -32,6 +32,7 @@
  */
 
 #include <helper/list.h>
+#include <helper/time_support.h>
 #include "arm_jtag.h"
 
 /* three-bit ACK values for SWD access (sent LSB first) */
@@ -198,6 +199,13 @@ struct adi_ap {
 	 */
 	uint32_t memaccess_tck;
 
+	/* ADIv6 JTAG-DP: raise memaccess_tck on WAIT and lower it again, but
+	 * not below memaccess_tck_min, after memaccess_clean AP transactions
+	 * completed without WAIT */
+	bool memaccess_auto;
+	uint32_t memaccess_tck_min;
+	uint32_t memaccess_clean;
+
 	/* Size of TAR autoincrement block, ARM ADI Specification requires at least 10 bits */
 	uint32_t tar_autoincr_block;
 
@@ -217,6 +225,25 @@ struct adi_ap {
 };
 
 
+/**
+ * Link statistics of a DAP, always collected and reported by "$dap perf".
+ * Transactions are counted as queued through the dap_queue_*() API; the
+ * DP/AP selection done internally by the transports is not included.
+ */
+struct adi_dap_perf {
+	uint64_t dp_reads;
+	uint64_t dp_writes;
+	uint64_t ap_reads;
+	uint64_t ap_writes;
+	uint64_t ap_aborts;
+	/* transactions answered with WAIT and retried */
+	uint64_t waits;
+	/* flushes that returned an error */
+	uint64_t errors;
+	/* duration of dap_run() and dap_sync() flushes */
+	struct latency_hist runs;
+};
+
 /**
  * This represents an ARM Debug Interface () Debug Access Port (DAP).
  * A DAP has two types of component:  one Debug Port (DP), which is a
@@ -246,6 +273,12 @@ struct adi_dap {
 	/* number of dap_cmd objects in the pool */
 	size_t cmd_pool_size;
 
+	/* ADIv6 JTAG-DP: preallocated ring of dap_cmd objects, the journal
+	 * is the range [cmd_ring_head, cmd_ring_tail) */
+	struct dap_cmd *cmd_ring;
+	unsigned int cmd_ring_head;
+	unsigned int cmd_ring_tail;
+
 	struct jtag_tap *tap;
 	/* Control config */
 	uint32_t dp_ctrl_stat;
@@ -297,6 +330,8 @@ struct adi_dap {
 
 	/* ADI-v6 only field indicating ROM Table address size */
 	uint32_t asize;
+
+	struct adi_dap_perf perf;
 };
 
 /**
@@ -374,6 +409,16 @@ static inline int dap_send_sequence(struct adi_dap *dap,
 	return dap->dp_ops->send_sequence(dap, seq);
 }
 
+/* One block transfer of a mem_ap_xfer_batch() */
+struct adi_xfer {
+	struct adi_ap *ap;
+	bool write;
+	uint8_t *buffer;		/* only read from for writes */
+	uint32_t size;
+	uint32_t count;
+	target_addr_t address;
+};
+
 /* Exported DAP operations by different ADI version implementations */
 struct dap_ops {
 	int (*mem_ap_read_u32)(struct adi_ap *ap,
@@ -392,6 +437,8 @@ struct dap_ops {
 			uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
 	int (*mem_ap_write_buf_noincr)(struct adi_ap *ap,
 			const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
+	int (*mem_ap_xfer_batch)(struct adi_dap *dap,
+			struct adi_xfer *xfers, unsigned int num);
 	int (*mem_ap_init)(struct adi_ap *ap);
 	int (*dp_init)(struct adi_dap *dap);
 	int (*dp_init_or_reconnect)(struct adi_dap *dap);
@@ -432,6 +479,7 @@ static inline int dap_queue_dp_read(struct adi_dap *dap,
 		unsigned reg, uint32_t *data)
 {
 	assert(dap->dp_ops != NULL);
+	dap->perf.dp_reads++;
 	return dap->dp_ops->queue_dp_read(dap, reg, data);
 }
 
@@ -450,6 +498,7 @@ static inline int dap_queue_dp_write(struct adi_dap *dap,
 		unsigned reg, uint32_t data)
 {
 	assert(dap->dp_ops != NULL);
+	dap->perf.dp_writes++;
 	return dap->dp_ops->queue_dp_write(dap, reg, data);
 }
 
@@ -467,6 +516,7 @@ static inline int dap_queue_ap_read(struct adi_ap *ap,
 		unsigned reg, uint32_t *data)
 {
 	assert(ap->dap->dp_ops != NULL);
+	ap->dap->perf.ap_reads++;
 	return ap->dap->dp_ops->queue_ap_read(ap, reg, data);
 }
 
@@ -483,6 +533,7 @@ static inline int dap_queue_ap_write(struct adi_ap *ap,
 		unsigned reg, uint32_t data)
 {
 	assert(ap->dap->dp_ops != NULL);
+	ap->dap->perf.ap_writes++;
 	return ap->dap->dp_ops->queue_ap_write(ap, reg, data);
 }
 
@@ -500,6 +551,7 @@ static inline int dap_queue_ap_write(struct adi_ap *ap,
 static inline int dap_queue_ap_abort(struct adi_dap *dap, uint8_t *ack)
 {
 	assert(dap->dp_ops != NULL);
+	dap->perf.ap_aborts++;
 	return dap->dp_ops->queue_ap_abort(dap, ack);
 }
 
@@ -516,15 +568,26 @@ static inline int dap_queue_ap_abort(struct adi_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adi_dap *dap)
 {
 	assert(dap->dp_ops != NULL);
-	return dap->dp_ops->run(dap);
+	int64_t start = timeval_us();
+	int retval = dap->dp_ops->run(dap);
+	latency_hist_add(&dap->perf.runs, timeval_us() - start);
+	if (retval != ERROR_OK)
+		dap->perf.errors++;
+	return retval;
 }
 
 static inline int dap_sync(struct adi_dap *dap)
 {
 	assert(dap->dp_ops != NULL);
-	if (dap->dp_ops->sync)
-		return dap->dp_ops->sync(dap);
-	return ERROR_OK;
+	if (!dap->dp_ops->sync)
+		return ERROR_OK;
+
+	int64_t start = timeval_us();
+	int retval = dap->dp_ops->sync(dap);
+	latency_hist_add(&dap->perf.runs, timeval_us() - start);
+	if (retval != ERROR_OK)
+		dap->perf.errors++;
+	return retval;
 }
 
 static inline int dap_dp_read_atomic(struct adi_dap *dap, unsigned reg,
@@ -611,6 +674,28 @@ static inline int mem_ap_write_buf_noincr(struct adi_ap *ap,
 	return ap->dap->dap_ops->mem_ap_write_buf_noincr(ap, buffer, size, count, address);
 }
 
+/* Synchronous batch of block transfers on MEM-APs of the same DAP, run in
+ * a single round trip where the implementation supports it. */
+static inline int mem_ap_xfer_batch(struct adi_dap *dap,
+		struct adi_xfer *xfers, unsigned int num)
+{
+	if (dap->dap_ops->mem_ap_xfer_batch)
+		return dap->dap_ops->mem_ap_xfer_batch(dap, xfers, num);
+
+	for (unsigned int i = 0; i < num; i++) {
+		int retval;
+		if (xfers[i].write)
+			retval = mem_ap_write_buf(xfers[i].ap, xfers[i].buffer,
+					xfers[i].size, xfers[i].count, xfers[i].address);
+		else
+			retval = mem_ap_read_buf(xfers[i].ap, xfers[i].buffer,
+					xfers[i].size, xfers[i].count, xfers[i].address);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
+
 /* Initialisation of the debug system, power domains and registers */
 static inline int dap_dp_init(struct adi_dap *dap)
 {
@@ -96,8 +96,10 @@ void adiv6_dap_instance_init(struct adi_dap *dap)
 		dap->ap[i].ap_num = i;
 		/* by default init base address at 16-bit granularity */
 		dap->ap[i].base_addr = i << 16;
-		/* default number of TCK clocks between AP accesses */
+		/* default number of TCK clocks between AP accesses; tuning
+		 * to the WAIT rate seen on JTAG-DP is enabled by memaccess */
 		dap->ap[i].memaccess_tck = 20;
+		dap->ap[i].memaccess_auto = false;
 		/* Number of bits for tar autoincrement, impl. dep. at least 10 */
 		dap->ap[i].tar_autoincr_block = (1<<10);
 		/* default CSW value */
@@ -355,18 +357,10 @@ static int adiv6_mem_ap_write_atomic_u32(struct adi_ap *ap, target_addr_t addres
 }
 
 /**
- * Synchronous write of a block of memory, using a specific access size.
- *
- * @param ap The MEM-AP to access.
- * @param buffer The data buffer to write. No particular alignment is assumed.
- * @param size Which access size to use, in bytes. 1, 2 or 4.
- * @param count The number of writes to do (in size units, not bytes).
- * @param address Address to be written; it must be writable by the currently selected MEM-AP.
- * @param addrinc Whether the target address should be increased for each write or not. This
- *  should normally be true, except when writing to e.g. a FIFO.
- * @return ERROR_OK on success, otherwise an error code.
+ * Queue a write of a block of memory, using a specific access size.
+ * The queue is not run; see adiv6_mem_ap_write() for the parameters.
  */
-static int adiv6_mem_ap_write(struct adi_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+static int adiv6_mem_ap_queue_write(struct adi_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
 		target_addr_t address, bool addrinc)
 {
 	struct adi_dap *dap = ap->dap;
@@ -470,9 +464,30 @@ static int adiv6_mem_ap_write(struct adi_ap *ap, const uint8_t *buffer, uint32_t
 			address += this_size;
 	}
 
-	/* REVISIT: Might want to have a queued version of this function that does not run. */
+	return retval;
+}
+
+/**
+ * Synchronous write of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to write. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2 or 4.
+ * @param count The number of writes to do (in size units, not bytes).
+ * @param address Address to be written; it must be writable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased for each write or not. This
+ *  should normally be true, except when writing to e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int adiv6_mem_ap_write(struct adi_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t address, bool addrinc)
+{
+	int retval = adiv6_mem_ap_queue_write(ap, buffer, size, count, address, addrinc);
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS)
+		return retval;
+
 	if (retval == ERROR_OK)
-		retval = dap_run(dap);
+		retval = dap_run(ap->dap);
 
 	if (retval != ERROR_OK) {
 		target_addr_t tar;
@@ -486,34 +501,20 @@ static int adiv6_mem_ap_write(struct adi_ap *ap, const uint8_t *buffer, uint32_t
 }
 
 /**
- * Synchronous read of a block of memory, using a specific access size.
- *
- * @param ap The MEM-AP to access.
- * @param buffer The data buffer to receive the data. No particular alignment is assumed.
- * @param size Which access size to use, in bytes. 1, 2 or 4.
- * @param count The number of reads to do (in size units, not bytes).
- * @param address Address to be read; it must be readable by the currently selected MEM-AP.
- * @param addrinc Whether the target address should be increased after each read or not. This
- *  should normally be true, except when reading from e.g. a FIFO.
- * @return ERROR_OK on success, otherwise an error code.
+ * Queue the sequence of DRW reads for a block read, using a specific access
+ * size. Each read stores the entire DRW word in read_buf, which must hold
+ * count words; adiv6_mem_ap_unpack_read() extracts the data once the queue
+ * has run. See adiv6_mem_ap_read() for the other parameters.
  */
-static int adiv6_mem_ap_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size, uint32_t count,
-		target_addr_t adr, bool addrinc)
+static int adiv6_mem_ap_queue_read(struct adi_ap *ap, uint32_t *read_buf, uint32_t size, uint32_t count,
+		target_addr_t address, bool addrinc)
 {
-	struct adi_dap *dap = ap->dap;
 	size_t nbytes = size * count;
 	const uint32_t csw_addrincr = addrinc ? CSW_ADDRINC_SINGLE : CSW_ADDRINC_OFF;
 	uint32_t csw_size;
-	target_addr_t address = adr;
+	uint32_t *read_ptr = read_buf;
 	int retval = ERROR_OK;
 
-	/* TI BE-32 Quirks mode:
-	 * Reads on big-endian TMS570 behave strangely differently than writes.
-	 * They read from the physical address requested, but with DRW byte-reversed.
-	 * For example, a byte read from address 0 will place the result in the high bytes of DRW.
-	 * Also, packed 8-bit and 16-bit transfers seem to sometimes return garbage in some bytes,
-	 * so avoid them. */
-
 	if (size == 4)
 		csw_size = CSW_32BIT;
 	else if (size == 2)
@@ -523,23 +524,11 @@ static int adiv6_mem_ap_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size,
 	else
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	if (ap->unaligned_access_bad && (adr % size != 0))
+	if (ap->unaligned_access_bad && (address % size != 0))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
-	 * over-allocation if packed transfers are going to be used, but determining the real need at
-	 * this point would be messy. */
-	uint32_t *read_buf = calloc(count, sizeof(uint32_t));
-	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
-	uint32_t *read_ptr = read_buf;
-	if (read_buf == NULL) {
-		LOG_ERROR("Failed to allocate read buffer");
-		return ERROR_FAIL;
-	}
-
-	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
-	 * useful bytes it contains, and their location in the word, depends on the type of transfer
-	 * and alignment. */
+	/* Queue up all reads. How many useful bytes each word contains, and their location in
+	 * the word, depends on the type of transfer and alignment. */
 	while (nbytes > 0) {
 		uint32_t this_size = size;
 
@@ -569,30 +558,22 @@ static int adiv6_mem_ap_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size,
 		adiv6_mem_ap_update_tar_cache(ap);
 	}
 
-	if (retval == ERROR_OK)
-		retval = dap_run(dap);
-
-	/* Restore state */
-	address = adr;
-	nbytes = size * count;
-	read_ptr = read_buf;
-
-	/* If something failed, read TAR to find out how much data was successfully read, so we can
-	 * at least give the caller what we have. */
-	if (retval != ERROR_OK) {
-		target_addr_t tar;
-		if (adiv6_mem_ap_read_tar(ap, &tar) == ERROR_OK) {
-			/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
-			LOG_ERROR("Failed to read memory at 0x%16.16" PRIx64, tar);
-			if (nbytes > tar - address)
-				nbytes = tar - address;
-		} else {
-			LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
-			nbytes = 0;
-		}
-	}
+	return retval;
+}
 
-	/* Replay loop to populate caller's buffer from the correct word and byte lane */
+/**
+ * Populate the caller's buffer with the first nbytes of a block read queued
+ * by adiv6_mem_ap_queue_read(), picking the correct word and byte lane.
+ */
+static void adiv6_mem_ap_unpack_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size, size_t nbytes,
+		target_addr_t address, bool addrinc, const uint32_t *read_ptr)
+{
+	/* TI BE-32 Quirks mode:
+	 * Reads on big-endian TMS570 behave strangely differently than writes.
+	 * They read from the physical address requested, but with DRW byte-reversed.
+	 * For example, a byte read from address 0 will place the result in the high bytes of DRW.
+	 * Also, packed 8-bit and 16-bit transfers seem to sometimes return garbage in some bytes,
+	 * so avoid them. */
 	while (nbytes > 0) {
 		uint32_t this_size = size;
 
@@ -601,7 +582,7 @@ static int adiv6_mem_ap_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size,
 			this_size = 4;
 		}
 
-		if (dap->ti_be_32_quirks) {
+		if (ap->dap->ti_be_32_quirks) {
 			switch (this_size) {
 			case 4:
 				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
@@ -630,6 +611,61 @@ static int adiv6_mem_ap_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size,
 		read_ptr++;
 		nbytes -= this_size;
 	}
+}
+
+/**
+ * Synchronous read of a block of memory, using a specific access size.
+ *
+ * @param ap The MEM-AP to access.
+ * @param buffer The data buffer to receive the data. No particular alignment is assumed.
+ * @param size Which access size to use, in bytes. 1, 2 or 4.
+ * @param count The number of reads to do (in size units, not bytes).
+ * @param address Address to be read; it must be readable by the currently selected MEM-AP.
+ * @param addrinc Whether the target address should be increased after each read or not. This
+ *  should normally be true, except when reading from e.g. a FIFO.
+ * @return ERROR_OK on success, otherwise an error code.
+ */
+static int adiv6_mem_ap_read(struct adi_ap *ap, uint8_t *buffer, uint32_t size, uint32_t count,
+		target_addr_t adr, bool addrinc)
+{
+	size_t nbytes = size * count;
+	int retval;
+
+	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
+	 * over-allocation if packed transfers are going to be used, but determining the real need at
+	 * this point would be messy. */
+	uint32_t *read_buf = calloc(count, sizeof(uint32_t));
+	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
+	if (read_buf == NULL) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
+	}
+
+	retval = adiv6_mem_ap_queue_read(ap, read_buf, size, count, adr, addrinc);
+	if (retval == ERROR_TARGET_UNALIGNED_ACCESS) {
+		free(read_buf);
+		return retval;
+	}
+
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+
+	/* If something failed, read TAR to find out how much data was successfully read, so we can
+	 * at least give the caller what we have. */
+	if (retval != ERROR_OK) {
+		target_addr_t tar;
+		if (adiv6_mem_ap_read_tar(ap, &tar) == ERROR_OK) {
+			/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
+			LOG_ERROR("Failed to read memory at 0x%16.16" PRIx64, tar);
+			if (nbytes > tar - adr)
+				nbytes = tar - adr;
+		} else {
+			LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
+			nbytes = 0;
+		}
+	}
+
+	adiv6_mem_ap_unpack_read(ap, buffer, size, nbytes, adr, addrinc, read_buf);
 
 	free(read_buf);
 	return retval;
@@ -659,6 +695,97 @@ static int adiv6_mem_ap_write_buf_noincr(struct adi_ap *ap,
 	return adiv6_mem_ap_write(ap, buffer, size, count, address, false);
 }
 
+/**
+ * Synchronous batch of block transfers on any of the MEM-APs of a DAP.
+ *
+ * All transfers are queued back to back and flushed with a single dap_run(),
+ * so accesses to different APs (e.g. a firmware mailbox behind one AP and
+ * core debug registers behind another) share the same adapter round trip.
+ * Transfers are issued in array order: the DAP does not order accesses to
+ * different APs against each other, so reordering them could break mailbox
+ * style protocols, and accesses to the same AP must keep program order
+ * anyway. The SELECT cache elides the bank switch between consecutive
+ * transfers to the same AP, and the per-AP CSW and TAR caches stay valid
+ * across switches.
+ *
+ * On failure there is no way to tell which transfer faulted; the TAR cache
+ * of every AP involved is invalidated and no read data is returned.
+ * Everything that can be rejected up front is checked before anything is
+ * queued, and once something is queued the queue is always run before the
+ * read buffers are freed.
+ */
+static int adiv6_mem_ap_xfer_batch(struct adi_dap *dap, struct adi_xfer *xfers, unsigned int num)
+{
+	uint32_t **read_bufs = calloc(num, sizeof(uint32_t *));
+	int retval = ERROR_OK;
+	unsigned int i;
+
+	if (read_bufs == NULL) {
+		LOG_ERROR("Failed to allocate read buffer");
+		return ERROR_FAIL;
+	}
+
+	for (i = 0; i < num && retval == ERROR_OK; i++) {
+		struct adi_xfer *xfer = &xfers[i];
+
+		if (xfer->ap->dap != dap) {
+			LOG_ERROR("Batched transfer on an AP of another DAP");
+			retval = ERROR_FAIL;
+		} else if (xfer->size != 1 && xfer->size != 2 && xfer->size != 4) {
+			retval = ERROR_TARGET_UNALIGNED_ACCESS;
+		} else if (xfer->ap->unaligned_access_bad && (xfer->address % xfer->size != 0)) {
+			retval = ERROR_TARGET_UNALIGNED_ACCESS;
+		} else if (!xfer->write && xfer->count) {
+			read_bufs[i] = calloc(xfer->count, sizeof(uint32_t));
+			if (read_bufs[i] == NULL) {
+				LOG_ERROR("Failed to allocate read buffer");
+				retval = ERROR_FAIL;
+			}
+		}
+	}
+
+	if (retval != ERROR_OK) {
+		for (i = 0; i < num; i++)
+			free(read_bufs[i]);
+		free(read_bufs);
+		return retval;
+	}
+
+	for (i = 0; i < num && retval == ERROR_OK; i++) {
+		struct adi_xfer *xfer = &xfers[i];
+
+		if (xfer->write)
+			retval = adiv6_mem_ap_queue_write(xfer->ap, xfer->buffer, xfer->size,
+					xfer->count, xfer->address, true);
+		else
+			retval = adiv6_mem_ap_queue_read(xfer->ap, read_bufs[i], xfer->size,
+					xfer->count, xfer->address, true);
+	}
+
+	/* run even a partially queued batch: the queued reads point into
+	 * read_bufs, and the writes must not leak into the next dap_run() */
+	int run_retval = dap_run(dap);
+	if (retval == ERROR_OK)
+		retval = run_retval;
+
+	for (i = 0; i < num; i++) {
+		struct adi_xfer *xfer = &xfers[i];
+
+		if (retval != ERROR_OK)
+			xfer->ap->tar_valid = false;
+		else if (!xfer->write)
+			adiv6_mem_ap_unpack_read(xfer->ap, xfer->buffer, xfer->size,
+					xfer->size * xfer->count, xfer->address, true, read_bufs[i]);
+		free(read_bufs[i]);
+	}
+	free(read_bufs);
+
+	if (retval != ERROR_OK)
+		LOG_ERROR("Failed to run a batch of %u MEM-AP transfers", num);
+
+	return retval;
+}
+
 /*--------------------------------------------------------------------------*/
 
 
@@ -2226,22 +2353,39 @@ int adiv6_dap_baseaddr_command(struct command_invocation *cmd)
 int adiv6_dap_memaccess_command(struct command_invocation *cmd)
 {
 	struct adi_dap *dap = adi_get_dap(CMD_DATA);
+	struct adi_ap *ap = &dap->ap[dap->apsel];
 	uint32_t memaccess_tck;
 
 	switch (CMD_ARGC) {
 	case 0:
-		memaccess_tck = dap->ap[dap->apsel].memaccess_tck;
 		break;
 	case 1:
+		if (!strcmp(CMD_ARGV[0], "auto")) {
+			/* tune from the current value, down to no delay */
+			ap->memaccess_auto = true;
+			ap->memaccess_tck_min = 0;
+			ap->memaccess_clean = 0;
+			break;
+		}
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], memaccess_tck);
+		ap->memaccess_tck = memaccess_tck;
+		ap->memaccess_auto = false;
+		break;
+	case 2:
+		if (strcmp(CMD_ARGV[1], "auto"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], memaccess_tck);
+		ap->memaccess_tck = memaccess_tck;
+		ap->memaccess_tck_min = memaccess_tck;
+		ap->memaccess_auto = true;
+		ap->memaccess_clean = 0;
 		break;
 	default:
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
-	dap->ap[dap->apsel].memaccess_tck = memaccess_tck;
 
-	command_print(CMD, "memory bus access delay set to %" PRIi32 " tck",
-			dap->ap[dap->apsel].memaccess_tck);
+	command_print(CMD, "memory bus access delay set to %" PRIu32 " tck%s",
+			ap->memaccess_tck, ap->memaccess_auto ? " (auto)" : "");
 
 	return ERROR_OK;
 }
@@ -2255,6 +2399,7 @@ static const struct dap_ops adiv6_dap_ops = {
 	.mem_ap_write_buf	= adiv6_mem_ap_write_buf,
 	.mem_ap_read_buf_noincr = adiv6_mem_ap_read_buf_noincr,
 	.mem_ap_write_buf_noincr = adiv6_mem_ap_write_buf_noincr,
+	.mem_ap_xfer_batch	= adiv6_mem_ap_xfer_batch,
 	.mem_ap_init		= adiv6_mem_ap_init,
 	.dp_init		= adiv6_dap_dp_init,
 	.dp_init_or_reconnect	= adiv6_dap_dp_init_or_reconnect,
@@ -486,6 +486,124 @@ COMMAND_HANDLER(dap_ti_be_32_quirks_command)
 		"TI BE-32 quirks mode");
 }
 
+/* Read word ranges behind several APs in one batch, one line per range */
+#define DAP_BATCHREAD_MAX_RANGES 16
+#define DAP_BATCHREAD_MAX_WORDS 1024
+
+COMMAND_HANDLER(dap_batchread_command)
+{
+	struct adi_dap *dap = adi_get_dap(CMD_DATA);
+	struct adi_xfer xfers[DAP_BATCHREAD_MAX_RANGES];
+	unsigned int num = CMD_ARGC / 3;
+	int retval = ERROR_OK;
+
+	if (CMD_ARGC == 0 || CMD_ARGC % 3 || num > DAP_BATCHREAD_MAX_RANGES)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	memset(xfers, 0, sizeof(xfers));
+	for (unsigned int i = 0; i < num; i++) {
+		uint32_t apsel;
+
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3 * i], apsel);
+		if (apsel > DP_APSEL_MAX) {
+			command_print(CMD, "Invalid AP number");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[3 * i + 1], xfers[i].address);
+		if (xfers[i].address & 3) {
+			command_print(CMD, "Invalid address (should be 4 bytes aligned)");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3 * i + 2], xfers[i].count);
+		if (xfers[i].count == 0 || xfers[i].count > DAP_BATCHREAD_MAX_WORDS) {
+			command_print(CMD, "Invalid count (should be 1 to %d)",
+					DAP_BATCHREAD_MAX_WORDS);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		xfers[i].ap = dap_ap(dap, apsel);
+		xfers[i].size = 4;
+	}
+
+	for (unsigned int i = 0; i < num && retval == ERROR_OK; i++) {
+		xfers[i].buffer = malloc(4 * xfers[i].count);
+		if (xfers[i].buffer == NULL) {
+			LOG_ERROR("Failed to allocate read buffer");
+			retval = ERROR_FAIL;
+		}
+	}
+
+	if (retval == ERROR_OK)
+		retval = mem_ap_xfer_batch(dap, xfers, num);
+
+	for (unsigned int i = 0; i < num; i++) {
+		if (retval == ERROR_OK) {
+			char line[DAP_BATCHREAD_MAX_WORDS * 11 + 1];
+			size_t len = 0;
+
+			line[0] = '\0';
+			for (unsigned int j = 0; j < xfers[i].count; j++)
+				len += snprintf(line + len, sizeof(line) - len, "%s0x%08" PRIx32,
+						j ? " " : "", buf_get_u32(xfers[i].buffer + 4 * j, 0, 32));
+			command_print(CMD, "%s", line);
+		}
+		free(xfers[i].buffer);
+	}
+
+	return retval;
+}
+
+COMMAND_HANDLER(dap_perf_command)
+{
+	struct adi_dap *dap = adi_get_dap(CMD_DATA);
+	struct adi_dap_perf *perf = &dap->perf;
+	bool json = false;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (!strcmp(CMD_ARGV[0], "reset")) {
+			memset(perf, 0, sizeof(*perf));
+			return ERROR_OK;
+		}
+		if (strcmp(CMD_ARGV[0], "json"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		json = true;
+	}
+
+	if (json) {
+		char buckets[LATENCY_HIST_JSON_MAX];
+
+		latency_hist_json(&perf->runs, buckets, sizeof(buckets));
+
+		command_print(CMD, "{\"dap\": \"%s\", \"dp_reads\": %" PRIu64
+				", \"dp_writes\": %" PRIu64 ", \"ap_reads\": %" PRIu64
+				", \"ap_writes\": %" PRIu64 ", \"ap_aborts\": %" PRIu64
+				", \"waits\": %" PRIu64 ", \"errors\": %" PRIu64
+				", \"runs\": %" PRIu64 ", \"run_us\": %" PRIu64
+				", \"run_us_max\": %" PRIu64 ", \"run_us_log2\": [%s]}",
+				adi_dap_name(dap), perf->dp_reads, perf->dp_writes,
+				perf->ap_reads, perf->ap_writes, perf->ap_aborts,
+				perf->waits, perf->errors, perf->runs.count,
+				perf->runs.total_us, perf->runs.max_us, buckets);
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "DP reads/writes: %" PRIu64 "/%" PRIu64,
+			perf->dp_reads, perf->dp_writes);
+	command_print(CMD, "AP reads/writes: %" PRIu64 "/%" PRIu64,
+			perf->ap_reads, perf->ap_writes);
+	command_print(CMD, "AP aborts:       %" PRIu64, perf->ap_aborts);
+	command_print(CMD, "WAIT retries:    %" PRIu64, perf->waits);
+	command_print(CMD, "failed runs:     %" PRIu64, perf->errors);
+	command_print(CMD, "runs:            %" PRIu64 ", %" PRIu64 " us total, %" PRIu64 " us max",
+			perf->runs.count, perf->runs.total_us, perf->runs.max_us);
+	latency_hist_print(CMD, &perf->runs);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration dap_subcommand_handlers[] = {
 	{
 		.name = "create",
@@ -595,8 +713,25 @@ const struct command_registration adi_dap_instance_commands[] = {
 		.handler = dap_memaccess_command,
 		.mode = COMMAND_EXEC,
 		.help = "set/get number of extra tck for MEM-AP memory "
-			"bus access [0-255]",
-		.usage = "[cycles]",
+			"bus access [0-255], 'auto' adapts it to the WAIT "
+			"rate on ADIv6 JTAG-DP",
+		.usage = "[cycles] ['auto']",
+	},
+	{
+		.name = "batchread",
+		.handler = dap_batchread_command,
+		.mode = COMMAND_EXEC,
+		.help = "read words from MEM-APs in a single batch of DAP transactions, "
+			"one line of words per range",
+		.usage = "ap_num address count [ap_num address count]...",
+	},
+	{
+		.name = "perf",
+		.handler = dap_perf_command,
+		.mode = COMMAND_ANY,
+		.help = "display, reset or export as JSON the transaction "
+			"counters and flush latencies of the DAP",
+		.usage = "['reset'|'json']",
 	},
 	{
 		.name = "ti_be_32_quirks",
@@ -146,6 +146,12 @@ struct arm_dpm {
 	/** Recent exception level on armv8 */
 	unsigned int last_el;
 
+	/**
+	 * ARMv8 only: instructions are queued without waiting for DSCR.ITE,
+	 * DSCR is checked once when the queue is flushed.
+	 */
+	bool instr_queued;
+
 	/* FIXME -- read/write DCSR methods and symbols */
 };
 
@@ -28,6 +28,7 @@
 #include <helper/replacements.h>
 
 #include "armv8.h"
+#include "algorithm.h"
 #include "arm_disassembler.h"
 
 #include "register.h"
@@ -38,6 +39,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "armv8_cache.h"
 #include "armv8_opcodes.h"
 #include "target.h"
 #include "target_type.h"
@@ -926,18 +928,269 @@ int armv8_mmu_translate_va(struct target *target,  target_addr_t va, target_addr
 	return ERROR_OK;
 }
 
-/*  V8 method VA TO PA  */
-int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
-	target_addr_t *val, int meminfo)
+void armv8_mmu_tlb_invalidate(struct armv8_common *armv8)
+{
+	armv8->armv8_mmu.tlb_generation++;
+	armv8->armv8_mmu.walk_regime_valid = false;
+}
+
+static struct armv8_tlb_entry *armv8_tlb_find(struct armv8_common *armv8, target_addr_t va)
+{
+	struct armv8_mmu_common *mmu = &armv8->armv8_mmu;
+	uint64_t va_page = va >> ARMV8_TLB_PAGE_SHIFT;
+
+	if (!mmu->tlb)
+		return NULL;
+
+	struct armv8_tlb_entry *e = &mmu->tlb[va_page % ARMV8_TLB_SIZE];
+	if (e->generation != mmu->tlb_generation || e->va_page != va_page
+			|| e->mode != armv8->arm.core_mode)
+		return NULL;
+
+	return e;
+}
+
+static bool armv8_tlb_lookup(struct armv8_common *armv8, target_addr_t va, target_addr_t *pa)
+{
+	struct armv8_tlb_entry *e = armv8_tlb_find(armv8, va);
+
+	if (!e)
+		return false;
+
+	*pa = (e->pa_page << ARMV8_TLB_PAGE_SHIFT) | (va & ((1 << ARMV8_TLB_PAGE_SHIFT) - 1));
+	return true;
+}
+
+static void armv8_tlb_insert(struct armv8_common *armv8,
+	uint64_t va_page, uint64_t pa_page, uint64_t par)
+{
+	struct armv8_mmu_common *mmu = &armv8->armv8_mmu;
+
+	if (!mmu->tlb) {
+		mmu->tlb = calloc(ARMV8_TLB_SIZE, sizeof(struct armv8_tlb_entry));
+		if (!mmu->tlb)
+			return;
+		/* entries start out invalid */
+		mmu->tlb_generation++;
+	}
+
+	struct armv8_tlb_entry *e = &mmu->tlb[va_page % ARMV8_TLB_SIZE];
+	e->va_page = va_page;
+	e->pa_page = pa_page;
+	e->mode = armv8->arm.core_mode;
+	e->par = par;
+	e->generation = mmu->tlb_generation;
+}
+
+/* Read the translation controls of the current EL2 or EL3 regime. */
+static int armv8_mmu_walk_regime(struct target *target)
 {
 	struct armv8_common *armv8 = target_to_armv8(target);
-	struct arm *arm = target_to_arm(target);
+	struct armv8_mmu_common *mmu = &armv8->armv8_mmu;
 	struct arm_dpm *dpm = &armv8->dpm;
-	enum arm_mode target_mode = ARM_MODE_ANY;
-	uint32_t retval;
-	uint32_t instr = 0;
-	uint64_t par;
+	uint64_t hcr = 0;
+	int retval;
 
+	if (mmu->walk_regime_valid)
+		return ERROR_OK;
+
+	if (armv8->arm.core_state != ARM_STATE_AARCH64)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	switch (armv8_curel_from_core_mode(armv8->arm.core_mode)) {
+	case SYSTEM_CUREL_EL2:
+	case SYSTEM_CUREL_EL3:
+		break;
+	default:
+		/* EL1&0 may be subject to a stage 2 translation */
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = dpm->prepare(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (armv8_curel_from_core_mode(armv8->arm.core_mode) == SYSTEM_CUREL_EL3) {
+		retval = dpm->instr_read_data_r0_64(dpm,
+				ARMV8_MRS(SYSTEM_TCR_EL3, 0), &mmu->walk_tcr);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR0_EL3, 0), &mmu->walk_ttbr[0]);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_MAIR_EL3, 0), &mmu->walk_mair);
+	} else {
+		retval = dpm->instr_read_data_r0_64(dpm,
+				ARMV8_MRS(SYSTEM_HCR_EL2, 0), &hcr);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TCR_EL2, 0), &mmu->walk_tcr);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR0_EL2, 0), &mmu->walk_ttbr[0]);
+		if (retval == ERROR_OK)
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_MAIR_EL2, 0), &mmu->walk_mair);
+		/* HCR_EL2.E2H: EL2 uses the EL1 layout and both TTBRs */
+		if (retval == ERROR_OK && (hcr & (1ULL << 34)))
+			retval = dpm->instr_read_data_r0_64(dpm,
+					ARMV8_MRS(SYSTEM_TTBR1_EL2, 0), &mmu->walk_ttbr[1]);
+	}
+
+	dpm->finish(dpm);
+
+	if (retval != ERROR_OK)
+		return retval;
+
+	mmu->walk_two_ranges = (hcr & (1ULL << 34)) != 0;
+	mmu->walk_regime_valid = true;
+	return ERROR_OK;
+}
+
+/*
+ * Memory attributes of a block or page descriptor, in the format PAR_EL1
+ * reports them after an AT instruction. Only the EL3 regime is Secure.
+ */
+static uint64_t armv8_mmu_walk_attrs(struct armv8_common *armv8,
+	uint64_t desc, bool ns_table)
+{
+	struct armv8_mmu_common *mmu = &armv8->armv8_mmu;
+	uint64_t attr = (mmu->walk_mair >> (8 * ((desc >> 2) & 7))) & 0xff;
+	uint64_t sh = (desc >> 8) & 3;
+	bool ns = armv8_curel_from_core_mode(armv8->arm.core_mode) != SYSTEM_CUREL_EL3
+		|| ns_table || (desc & (1 << 5));
+
+	/* Device memory is reported as Outer Shareable */
+	if ((attr & 0xf0) == 0)
+		sh = 2;
+
+	return attr << 56 | (uint64_t)ns << 9 | sh << 7;
+}
+
+/*
+ * Translate va by walking the stage 1 translation tables of the current
+ * EL2 or EL3 regime on the host. The descriptors covering the aligned
+ * window of ARMV8_TLB_SIZE pages around va are read in one block and
+ * all of their translations are cached, so walking a virtual range costs
+ * one bulk read per window instead of one AT instruction per page.
+ * Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE for regimes or table formats
+ * this does not handle, the caller then uses an AT instruction.
+ */
+static int armv8_mmu_walk(struct target *target, target_addr_t va, target_addr_t *pa)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct armv8_mmu_common *mmu = &armv8->armv8_mmu;
+	const uint64_t oa_mask = 0x0000FFFFFFFFFFFFULL;
+	const uint64_t window = (uint64_t)ARMV8_TLB_SIZE << ARMV8_TLB_PAGE_SHIFT;
+	unsigned int tsz, tg, granule, stride, va_bits, level, start_level;
+	uint64_t table, desc, base, out;
+	uint8_t desc_buf[8];
+	bool upper, ns_table = false;
+	int retval;
+
+	retval = armv8_mmu_walk_regime(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	upper = mmu->walk_two_ranges && (va >> 63);
+	if (upper) {
+		if (mmu->walk_tcr & (1ULL << 23))	/* EPD1 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		tsz = (mmu->walk_tcr >> 16) & 0x3f;
+		/* TG1 encodes the granules differently from TG0 */
+		static const unsigned int tg1_to_tg0[4] = { 3, 2, 0, 1 };
+		tg = tg1_to_tg0[(mmu->walk_tcr >> 30) & 3];
+		table = mmu->walk_ttbr[1];
+	} else {
+		if (mmu->walk_two_ranges && (mmu->walk_tcr & (1ULL << 7)))	/* EPD0 */
+			return ERROR_TARGET_TRANSLATION_FAULT;
+		tsz = mmu->walk_tcr & 0x3f;
+		tg = (mmu->walk_tcr >> 14) & 3;
+		table = mmu->walk_ttbr[0];
+	}
+
+	if (tg == 0)
+		granule = 12;
+	else if (tg == 1)
+		granule = 16;
+	else if (tg == 2)
+		granule = 14;
+	else
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	va_bits = 64 - tsz;
+	if (va_bits > 48 || va_bits <= granule)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	/* the address must lie in the range of the selected TTBR */
+	if (((upper ? ~va : va) >> va_bits) != 0)
+		return ERROR_TARGET_TRANSLATION_FAULT;
+
+	stride = granule - 3;
+	start_level = 3 - (va_bits - granule - 1) / stride;
+	table &= oa_mask & ~1ULL;
+
+	for (level = start_level; level < 3; level++) {
+		unsigned int shift = granule + stride * (3 - level);
+		uint64_t index = (va >> shift) & ((1ULL << (level == start_level ? va_bits - shift : stride)) - 1);
+
+		retval = mmu->read_physical_memory(target, table + index * 8, 4, 2, desc_buf);
+		if (retval != ERROR_OK)
+			return retval;
+		desc = le_to_h_u64(desc_buf);
+
+		if ((desc & 3) == 3) {
+			table = desc & oa_mask & ~((1ULL << granule) - 1);
+			ns_table |= (desc >> 63) & 1;
+			continue;
+		}
+		if ((desc & 3) != 1 || level == 0)
+			return ERROR_TARGET_TRANSLATION_FAULT;
+
+		/* block mapping, always at least as large as the window */
+		base = va & ~(window - 1);
+		out = (desc & oa_mask & ~((1ULL << shift) - 1)) | (base & ((1ULL << shift) - 1));
+		uint64_t attrs = armv8_mmu_walk_attrs(armv8, desc, ns_table);
+		for (uint64_t off = 0; off < window; off += 1 << ARMV8_TLB_PAGE_SHIFT)
+			armv8_tlb_insert(armv8, (base + off) >> ARMV8_TLB_PAGE_SHIFT,
+					(out + off) >> ARMV8_TLB_PAGE_SHIFT, attrs);
+		*pa = out + (va & (window - 1));
+		return ERROR_OK;
+	}
+
+	/* last level: fetch the descriptors of the whole window at once */
+	unsigned int count = window >> granule;
+	uint64_t first = ((va & ~(window - 1)) >> granule) & ((1ULL << stride) - 1);
+	uint8_t *descs = malloc(count * 8);
+	if (!descs)
+		return ERROR_FAIL;
+
+	retval = mmu->read_physical_memory(target, table + first * 8, 4, count * 2, descs);
+	if (retval != ERROR_OK) {
+		free(descs);
+		return retval;
+	}
+
+	base = va & ~(window - 1);
+	for (unsigned int i = 0; i < count; i++) {
+		desc = le_to_h_u64(descs + i * 8);
+		if ((desc & 3) != 3)
+			continue;
+		out = desc & oa_mask & ~((1ULL << granule) - 1);
+		uint64_t attrs = armv8_mmu_walk_attrs(armv8, desc, ns_table);
+		for (uint64_t off = 0; off < (1ULL << granule); off += 1 << ARMV8_TLB_PAGE_SHIFT)
+			armv8_tlb_insert(armv8, (base + ((uint64_t)i << granule) + off) >> ARMV8_TLB_PAGE_SHIFT,
+					(out + off) >> ARMV8_TLB_PAGE_SHIFT, attrs);
+	}
+	free(descs);
+
+	if (!armv8_tlb_lookup(armv8, va, pa))
+		return ERROR_TARGET_TRANSLATION_FAULT;
+	return ERROR_OK;
+}
+
+/* Show the memory attributes of a successful address translation */
+static void armv8_log_meminfo(uint64_t par)
+{
 	static const char * const shared_name[] = {
 			"Non-", "UNDEFINED ", "Outer ", "Inner "
 	};
@@ -946,11 +1199,51 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 			"Secure", "Not Secure"
 	};
 
+	int SH = (par >> 7) & 3;
+	int NS = (par >> 9) & 1;
+	int ATTR = (par >> 56) & 0xFF;
+
+	char *memtype = (ATTR & 0xF0) == 0 ? "Device Memory" : "Normal Memory";
+
+	LOG_USER("%sshareable, %s",
+			shared_name[SH], secure_name[NS]);
+	LOG_USER("%s", memtype);
+}
+
+/*  V8 method VA TO PA  */
+int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
+	target_addr_t *val, int meminfo)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm *arm = target_to_arm(target);
+	struct arm_dpm *dpm = &armv8->dpm;
+	enum arm_mode target_mode = ARM_MODE_ANY;
+	struct armv8_tlb_entry *e;
+	uint32_t retval;
+	uint32_t instr = 0;
+	uint64_t par;
+
 	if (target->state != TARGET_HALTED) {
 		LOG_WARNING("target %s not halted", target_name(target));
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* cached translations keep their memory attributes for meminfo */
+	if (!armv8_tlb_find(armv8, va) && armv8->armv8_mmu.walk_enabled) {
+		int walk_retval = armv8_mmu_walk(target, va, val);
+		if (walk_retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE
+				&& walk_retval != ERROR_OK)
+			return walk_retval;
+	}
+
+	e = armv8_tlb_find(armv8, va);
+	if (e) {
+		armv8_tlb_lookup(armv8, va, val);
+		if (meminfo)
+			armv8_log_meminfo(e->par);
+		return ERROR_OK;
+	}
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -1003,17 +1296,10 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 		retval = ERROR_FAIL;
 	} else {
 		*val = (par & 0xFFFFFFFFF000UL) | (va & 0xFFF);
-		if (meminfo) {
-			int SH = (par >> 7) & 3;
-			int NS = (par >> 9) & 1;
-			int ATTR = (par >> 56) & 0xFF;
-
-			char *memtype = (ATTR & 0xF0) == 0 ? "Device Memory" : "Normal Memory";
-
-			LOG_USER("%sshareable, %s",
-					shared_name[SH], secure_name[NS]);
-			LOG_USER("%s", memtype);
-		}
+		armv8_tlb_insert(armv8, va >> ARMV8_TLB_PAGE_SHIFT,
+				(par & 0xFFFFFFFFF000UL) >> ARMV8_TLB_PAGE_SHIFT, par);
+		if (meminfo)
+			armv8_log_meminfo(par);
 	}
 
 	return retval;
@@ -1784,6 +2070,24 @@ void armv8_free_reg_cache(struct target *target)
 	arm->core_cache = NULL;
 }
 
+COMMAND_HANDLER(armv8_handle_mmu_walk_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv8_common *armv8 = target_to_armv8(target);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], armv8->armv8_mmu.walk_enabled);
+		armv8_mmu_tlb_invalidate(armv8);
+	}
+
+	command_print(CMD, "host side table walk %s",
+			armv8->armv8_mmu.walk_enabled ? "on" : "off");
+	return ERROR_OK;
+}
+
 const struct command_registration armv8_command_handlers[] = {
 	{
 		.name = "catch_exc",
@@ -1792,6 +2096,14 @@ const struct command_registration armv8_command_handlers[] = {
 		.help = "configure exception catch",
 		.usage = "[(nsec_el1,nsec_el2,sec_el1,sec_el3)+,off]",
 	},
+	{
+		.name = "mmu_walk",
+		.handler = armv8_handle_mmu_walk_command,
+		.mode = COMMAND_ANY,
+		.help = "translate virtual addresses of the EL2/EL3 regimes by "
+			"walking the translation tables on the host",
+		.usage = "['on'|'off']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1925,6 +2237,501 @@ int armv8_get_gdb_reg_list_noread(struct target *target,
 	}
 }
 
+static int armv8_run_algorithm_completion(struct target *target,
+	target_addr_t exit_point, int timeout_ms)
+{
+	struct arm *arm = target_to_arm(target);
+	uint64_t pc;
+	int retval;
+
+	retval = target_wait_state(target, TARGET_HALTED, timeout_ms);
+	if (retval != ERROR_OK || target->state != TARGET_HALTED) {
+		retval = target_halt(target);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = target_wait_state(target, TARGET_HALTED, 500);
+		if (retval != ERROR_OK)
+			return retval;
+		return ERROR_TARGET_TIMEOUT;
+	}
+
+	/* algorithms terminate with HLT, DLR_EL0 then points at that instruction */
+	pc = buf_get_u64(arm->pc->value, 0, 64);
+	if (exit_point && pc != exit_point) {
+		LOG_WARNING("target reentered debug state, but not at the desired exit point: 0x%16.16" PRIx64,
+			pc);
+		return ERROR_TARGET_TIMEOUT;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Run an AArch64 code fragment on a halted PE. The algorithm must end with an
+ * HLT instruction located at @a exit_point; no breakpoint is needed to catch
+ * it since OpenOCD keeps halting debug (EDSCR.HDE) enabled. x0-x30, sp, pc and
+ * cpsr are restored afterwards. Interrupts are masked while the code runs.
+ */
+int armv8_run_algorithm(struct target *target,
+	int num_mem_params, struct mem_param *mem_params,
+	int num_reg_params, struct reg_param *reg_params,
+	target_addr_t entry_point, target_addr_t exit_point,
+	int timeout_ms, void *arch_info)
+{
+	struct arm *arm = target_to_arm(target);
+	struct arm_algorithm *arm_algorithm_info = arch_info;
+	uint8_t context[ARMV8_xPSR + 1][8];
+	int smp = target->smp;
+	uint32_t cpsr;
+	int retval = ERROR_OK;
+	int i;
+
+	LOG_DEBUG("Running algorithm");
+
+	if (arm_algorithm_info->common_magic != ARM_COMMON_MAGIC) {
+		LOG_ERROR("current target isn't an ARM target");
+		return ERROR_TARGET_INVALID;
+	}
+
+	if (target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (arm->core_state != ARM_STATE_AARCH64
+			|| arm_algorithm_info->core_state != ARM_STATE_AARCH64) {
+		LOG_ERROR("BUG: can't execute algorithms when not in AArch64 state");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	/* save x0..x30, sp, pc and cpsr; they'll be restored later */
+	for (i = ARMV8_R0; i <= ARMV8_xPSR; i++) {
+		struct reg *r = arm->core_cache->reg_list + i;
+
+		if (!r->valid) {
+			retval = r->type->get(r);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		memcpy(context[i], r->value, DIV_ROUND_UP(r->size, 8));
+	}
+
+	for (i = 0; i < num_mem_params; i++) {
+		if (mem_params[i].direction == PARAM_IN)
+			continue;
+		retval = target_write_buffer(target, mem_params[i].address, mem_params[i].size,
+				mem_params[i].value);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (i = 0; i < num_reg_params; i++) {
+		if (reg_params[i].direction == PARAM_IN)
+			continue;
+
+		struct reg *reg = register_get_by_name(arm->core_cache, reg_params[i].reg_name, 0);
+		if (!reg) {
+			LOG_ERROR("BUG: register '%s' not found", reg_params[i].reg_name);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+
+		if (reg->size != reg_params[i].size) {
+			LOG_ERROR("BUG: register '%s' size doesn't match reg_params[i].size",
+				reg_params[i].reg_name);
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		}
+
+		retval = reg->type->set(reg, reg_params[i].value);
+		if (retval != ERROR_OK)
+			goto restore;
+	}
+
+	cpsr = buf_get_u32(arm->cpsr->value, 0, 32);
+	if (arm_algorithm_info->core_mode != ARM_MODE_ANY)
+		cpsr = (cpsr & ~0x1f) | (arm_algorithm_info->core_mode & 0x1f);
+	armv8_set_cpsr(arm, cpsr | SYSTEM_DAIF_MASK);
+
+	/*
+	 * Only this PE runs the algorithm: keep the resume from restarting the
+	 * rest of the SMP group and the halt from being reported to GDB.
+	 */
+	target->smp = 0;
+
+	retval = target_resume(target, 0, entry_point, 1, 1);
+	if (retval == ERROR_OK)
+		retval = armv8_run_algorithm_completion(target, exit_point, timeout_ms);
+
+	target->smp = smp;
+
+	if (retval != ERROR_OK)
+		goto restore;
+
+	for (i = 0; i < num_mem_params; i++) {
+		if (mem_params[i].direction != PARAM_OUT) {
+			int retvaltemp = target_read_buffer(target, mem_params[i].address,
+					mem_params[i].size,
+					mem_params[i].value);
+			if (retvaltemp != ERROR_OK)
+				retval = retvaltemp;
+		}
+	}
+
+	for (i = 0; i < num_reg_params; i++) {
+		if (reg_params[i].direction == PARAM_OUT)
+			continue;
+
+		struct reg *reg = register_get_by_name(arm->core_cache,
+				reg_params[i].reg_name, 0);
+		if (!reg) {
+			LOG_ERROR("BUG: register '%s' not found", reg_params[i].reg_name);
+			retval = ERROR_COMMAND_SYNTAX_ERROR;
+			continue;
+		}
+
+		if (!reg->valid) {
+			int retvaltemp = reg->type->get(reg);
+			if (retvaltemp != ERROR_OK) {
+				retval = retvaltemp;
+				continue;
+			}
+		}
+		buf_cpy(reg->value, reg_params[i].value, reg_params[i].size);
+	}
+
+restore:
+	if (target->state != TARGET_HALTED)
+		return retval;
+
+	for (i = ARMV8_R0; i <= ARMV8_xPSR; i++) {
+		struct reg *r = arm->core_cache->reg_list + i;
+
+		r->type->set(r, context[i]);
+	}
+
+	return retval;
+}
+
+/*
+ * Load algorithm code into a working area. Working areas get reused by
+ * different algorithms, so like a software breakpoint the code is cleaned to
+ * the point of unification and stale instructions are dropped from the
+ * I-cache. Caches that are off need no maintenance.
+ */
+static int armv8_write_algorithm_code(struct target *target,
+	target_addr_t address, uint32_t size, const uint8_t *code)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct armv8_cache_common *cache = &armv8->armv8_mmu.armv8_cache;
+	int retval;
+
+	if (cache->d_u_cache_enabled) {
+		retval = armv8_cache_d_inner_flush_virt(armv8, address, size);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = target_write_buffer(target, address, size, code);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (cache->d_u_cache_enabled) {
+		retval = armv8_cache_d_inner_flush_virt(armv8, address, size);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (cache->i_cache_enabled) {
+		retval = armv8_cache_i_inner_inval_virt(armv8, address, size);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Checksum memory on the target with the CRC32 instructions. Returns an error
+ * when the PE doesn't implement them, so the caller falls back to reading the
+ * memory and computing the CRC on the host.
+ */
+int armv8_checksum_memory(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct arm_dpm *dpm = armv8->arm.dpm;
+	struct working_area *crc_algorithm;
+	struct arm_algorithm arm_algo;
+	struct reg_param reg_params[2];
+	uint64_t isar0;
+	int retval;
+
+	static const uint8_t armv8_crc_code[] = {
+#include "../../contrib/loaders/checksum/armv8_crc.inc"
+	};
+
+	if (target->state != TARGET_HALTED) {
+		LOG_WARNING("target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (armv8->arm.core_state != ARM_STATE_AARCH64)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = dpm->prepare(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+	if (armv8_curel_from_core_mode(armv8->arm.core_mode) < SYSTEM_CUREL_EL1)
+		retval = armv8_dpm_modeswitch(dpm, ARMV8_64_EL1H);
+	if (retval == ERROR_OK)
+		retval = dpm->instr_read_data_r0_64(dpm,
+				ARMV8_MRS(SYSTEM_ID_AA64ISAR0_EL1, 0), &isar0);
+	armv8_dpm_modeswitch(dpm, ARM_MODE_ANY);
+	dpm->finish(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* ID_AA64ISAR0_EL1.CRC32 */
+	if (((isar0 >> 16) & 0xf) == 0) {
+		LOG_DEBUG("%s: no CRC32 instructions", target_name(target));
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_alloc_working_area(target,
+			sizeof(armv8_crc_code), &crc_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = armv8_write_algorithm_code(target, crc_algorithm->address,
+			sizeof(armv8_crc_code), armv8_crc_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_ANY;
+	arm_algo.core_state = ARM_STATE_AARCH64;
+
+	init_reg_param(&reg_params[0], "x0", 64, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "x1", 64, PARAM_OUT);
+
+	buf_set_u64(reg_params[0].value, 0, 64, address);
+	buf_set_u64(reg_params[1].value, 0, 64, count);
+
+	/* 20 second timeout/megabyte */
+	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+
+	retval = target_run_algorithm(target, 0, NULL, 2, reg_params,
+			crc_algorithm->address,
+			crc_algorithm->address + sizeof(armv8_crc_code) - 4,
+			timeout, &arm_algo);
+
+	if (retval == ERROR_OK)
+		*checksum = buf_get_u32(reg_params[0].value, 0, 32);
+	else
+		LOG_ERROR("error executing AArch64 crc algorithm");
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+cleanup:
+	target_free_working_area(target, crc_algorithm);
+
+	return retval;
+}
+
+/* Blank check a block the stub can't handle by reading it back */
+static int armv8_blank_check_host(struct target *target,
+	target_addr_t address, uint32_t size, uint8_t erased_value, uint32_t *result)
+{
+	uint8_t *buffer;
+	int retval;
+
+	*result = 1;
+	if (size == 0)
+		return ERROR_OK;
+
+	buffer = malloc(size);
+	if (buffer == NULL)
+		return ERROR_FAIL;
+
+	retval = target_read_buffer(target, address, size, buffer);
+	if (retval == ERROR_OK) {
+		for (uint32_t i = 0; i < size; i++) {
+			if (buffer[i] != erased_value) {
+				*result = 0;
+				break;
+			}
+		}
+	}
+
+	free(buffer);
+	return retval;
+}
+
+/*
+ * Check on the target whether memory blocks hold the erased value only.
+ * Returns the number of blocks checked, which may be less than @a num_blocks
+ * when the working area can't hold all block descriptors at once.
+ * The stub checks whole aligned words and takes a zero word count as the end
+ * of the list. Trailing bytes are checked on the host, a batch ends before a
+ * block the stub can't take, and such a block is checked alone on the host.
+ */
+int armv8_blank_check_memory(struct target *target,
+	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
+{
+	struct working_area *erase_check_algorithm;
+	struct working_area *erase_check_params;
+	struct reg_param reg_params[2];
+	struct arm_algorithm arm_algo;
+	int retval;
+
+	static bool timed_out;
+
+	static const uint8_t erase_check_code[] = {
+#include "../../contrib/loaders/erase_check/armv8_erase_check.inc"
+	};
+
+	const uint32_t code_size = sizeof(erase_check_code);
+
+	if (target_to_arm(target)->core_state != ARM_STATE_AARCH64)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (blocks[0].size < sizeof(uint32_t) || blocks[0].address % sizeof(uint32_t)) {
+		retval = armv8_blank_check_host(target, blocks[0].address,
+				blocks[0].size, erased_value, &blocks[0].result);
+		return retval == ERROR_OK ? 1 : retval;
+	}
+
+	/* make sure we have a working area */
+	if (target_alloc_working_area(target, code_size,
+		&erase_check_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = armv8_write_algorithm_code(target, erase_check_algorithm->address,
+			code_size, erase_check_code);
+	if (retval != ERROR_OK)
+		goto cleanup1;
+
+	/* prepare blocks array for algo */
+	struct algo_block {
+		union {
+			uint64_t size;
+			uint64_t result;
+		};
+		uint64_t address;
+	};
+
+	uint32_t avail = target_get_working_area_avail(target);
+	int blocks_to_check = avail / sizeof(struct algo_block) - 1;
+	if (num_blocks < blocks_to_check)
+		blocks_to_check = num_blocks;
+	for (int i = 1; i < blocks_to_check; i++) {
+		if (blocks[i].size < sizeof(uint32_t) || blocks[i].address % sizeof(uint32_t)) {
+			blocks_to_check = i;
+			break;
+		}
+	}
+
+	struct algo_block *params = malloc((blocks_to_check+1)*sizeof(struct algo_block));
+	if (params == NULL) {
+		retval = ERROR_FAIL;
+		goto cleanup1;
+	}
+
+	int i;
+	uint64_t total_size = 0;
+	for (i = 0; i < blocks_to_check; i++) {
+		total_size += blocks[i].size;
+		target_buffer_set_u64(target, (uint8_t *)&(params[i].size),
+						blocks[i].size / sizeof(uint32_t));
+		target_buffer_set_u64(target, (uint8_t *)&(params[i].address),
+						blocks[i].address);
+	}
+	target_buffer_set_u64(target, (uint8_t *)&(params[blocks_to_check].size), 0);
+
+	uint32_t param_size = (blocks_to_check + 1) * sizeof(struct algo_block);
+	if (target_alloc_working_area(target, param_size,
+			&erase_check_params) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup2;
+	}
+
+	retval = target_write_buffer(target, erase_check_params->address,
+				param_size, (uint8_t *)params);
+	if (retval != ERROR_OK)
+		goto cleanup3;
+
+	uint32_t erased_word = erased_value | (erased_value << 8)
+			       | (erased_value << 16) | (erased_value << 24);
+
+	LOG_DEBUG("Starting erase check of %d blocks, parameters@"
+		 TARGET_ADDR_FMT, blocks_to_check, erase_check_params->address);
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_ANY;
+	arm_algo.core_state = ARM_STATE_AARCH64;
+
+	init_reg_param(&reg_params[0], "x0", 64, PARAM_OUT);
+	buf_set_u64(reg_params[0].value, 0, 64, erase_check_params->address);
+
+	init_reg_param(&reg_params[1], "x1", 64, PARAM_OUT);
+	buf_set_u64(reg_params[1].value, 0, 64, erased_word);
+
+	/* assume CPU clk at least 1 MHz */
+	int timeout = (timed_out ? 30000 : 2000) + total_size * 3 / 1000;
+
+	retval = target_run_algorithm(target,
+				0, NULL,
+				ARRAY_SIZE(reg_params), reg_params,
+				erase_check_algorithm->address,
+				erase_check_algorithm->address + (code_size - 4),
+				timeout,
+				&arm_algo);
+
+	timed_out = retval == ERROR_TARGET_TIMEOUT;
+	if (retval != ERROR_OK && !timed_out)
+		goto cleanup4;
+
+	retval = target_read_buffer(target, erase_check_params->address,
+				param_size, (uint8_t *)params);
+	if (retval != ERROR_OK)
+		goto cleanup4;
+
+	for (i = 0; i < blocks_to_check; i++) {
+		uint64_t result = target_buffer_get_u64(target,
+					(uint8_t *)&(params[i].result));
+		if (result != 0 && result != 1)
+			break;
+
+		blocks[i].result = result;
+
+		uint32_t tail = blocks[i].size % sizeof(uint32_t);
+		if (result && tail) {
+			retval = armv8_blank_check_host(target,
+					blocks[i].address + blocks[i].size - tail, tail,
+					erased_value, &blocks[i].result);
+			if (retval != ERROR_OK)
+				goto cleanup4;
+		}
+	}
+	if (i && timed_out)
+		LOG_INFO("Slow CPU clock: %d blocks checked, %d remain. Continuing...", i, num_blocks-i);
+
+	retval = i;		/* return number of blocks really checked */
+
+cleanup4:
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+cleanup3:
+	target_free_working_area(target, erase_check_params);
+cleanup2:
+	free(params);
+cleanup1:
+	target_free_working_area(target, erase_check_algorithm);
+
+	return retval;
+}
+
 int armv8_set_dbgreg_bits(struct armv8_common *armv8, unsigned int reg, unsigned long mask, unsigned long value)
 {
 	uint32_t tmp;
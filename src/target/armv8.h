@@ -176,6 +176,18 @@ struct armv8_cache_common {
 			struct armv8_cache_common *armv8_cache);
 };
 
+/* VA to PA translation cache, direct mapped on 4KiB pages */
+#define ARMV8_TLB_PAGE_SHIFT	12
+#define ARMV8_TLB_SIZE		512
+
+struct armv8_tlb_entry {
+	uint64_t va_page;
+	uint64_t pa_page;
+	enum arm_mode mode;		/* core mode the translation was done in */
+	uint64_t par;			/* memory attributes in the PAR_EL1 format */
+	unsigned int generation;	/* valid if equal to armv8_mmu_common::tlb_generation */
+};
+
 struct armv8_mmu_common {
 	/* following field mmu working way */
 	int32_t ttbr1_used; /*  -1 not initialized, 0 no ttbr1 1 ttbr1 used and  */
@@ -189,6 +201,19 @@ struct armv8_mmu_common {
 			uint32_t size, uint32_t count, uint8_t *buffer);
 	struct armv8_cache_common armv8_cache;
 	uint32_t mmu_enabled;
+
+	/* translation cache, flushed on debug entry and on writes to memory or
+	 * system registers */
+	struct armv8_tlb_entry *tlb;
+	unsigned int tlb_generation;
+
+	/* host side table walk, see armv8_mmu_walk() */
+	bool walk_enabled;
+	bool walk_regime_valid;
+	bool walk_two_ranges;		/* TCR has the EL1 layout with TTBR0/TTBR1 */
+	uint64_t walk_tcr;
+	uint64_t walk_ttbr[2];
+	uint64_t walk_mair;
 };
 
 struct armv8_common {
@@ -223,6 +248,9 @@ struct armv8_common {
 	/* last run-control command issued to this target (resume, halt, step) */
 	enum run_control_op last_run_control_op;
 
+	/* debug entry only captured PC and CPSR, the rest is read on demand */
+	bool context_deferred;
+
 	/* Direct processor core register read and writes */
 	int (*read_reg_u64)(struct armv8_common *armv8, int num, uint64_t *value);
 	int (*write_reg_u64)(struct armv8_common *armv8, int num, uint64_t value);
@@ -267,6 +295,8 @@ static inline bool is_armv8(struct armv8_common *armv8)
 #define CPUV8_DBG_LOCKSTATUS 0xFB4
 
 #define CPUV8_DBG_EDESR		0x20
+#define CPUV8_DBG_EDPCSR	0x0A0
+#define CPUV8_DBG_EDDEVID	0xFC8
 #define CPUV8_DBG_EDECR		0x24
 #define CPUV8_DBG_WFAR0		0x30
 #define CPUV8_DBG_WFAR1		0x34
@@ -311,6 +341,17 @@ int armv8_init_arch_info(struct target *target, struct armv8_common *armv8);
 int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 		target_addr_t *val, int meminfo);
 int armv8_mmu_translate_va(struct target *target,  target_addr_t va, target_addr_t *val);
+void armv8_mmu_tlb_invalidate(struct armv8_common *armv8);
+
+int armv8_run_algorithm(struct target *target,
+	int num_mem_params, struct mem_param *mem_params,
+	int num_reg_params, struct reg_param *reg_params,
+	target_addr_t entry_point, target_addr_t exit_point,
+	int timeout_ms, void *arch_info);
+int armv8_checksum_memory(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum);
+int armv8_blank_check_memory(struct target *target,
+	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
 
 int armv8_handle_cache_info_command(struct command_invocation *cmd,
 		struct armv8_cache_common *armv8_cache);
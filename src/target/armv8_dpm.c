@@ -215,6 +215,14 @@ static int dpmv8_exec_opcode(struct arm_dpm *dpm,
 	if (p_dscr)
 		dscr = *p_dscr;
 
+	/* queued mode: just post the opcode, status is checked on flush */
+	if (dpm->instr_queued) {
+		if (armv8_dpm_get_core_state(dpm) != ARM_STATE_AARCH64)
+			opcode = T32_FMTITR(opcode);
+		return mem_ap_write_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_ITR, opcode);
+	}
+
 	/* Wait for InstrCompl bit to be set */
 	long long then = timeval_ms();
 	while ((dscr & DSCR_ITE) == 0) {
@@ -270,6 +278,75 @@ static int dpmv8_exec_opcode(struct arm_dpm *dpm,
 	return retval;
 }
 
+/*
+ * Start queueing instructions. ITR writes and DCC accesses are posted to
+ * the DAP queue back to back, relying on each instruction to complete
+ * before the next debug register access arrives, which holds for the
+ * simple register moves used here. Any violation is caught by the sticky
+ * overrun/underrun bits in DSCR when the queue is flushed.
+ */
+static void dpmv8_queue_begin(struct arm_dpm *dpm)
+{
+	dpm->instr_queued = true;
+}
+
+/*
+ * Execute all queued instructions and check DSCR once for the whole batch.
+ */
+static int dpmv8_queue_flush(struct arm_dpm *dpm)
+{
+	struct armv8_common *armv8 = dpm->arm->arch_info;
+	uint32_t dscr;
+	int retval;
+
+	dpm->instr_queued = false;
+
+	retval = mem_ap_read_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv8->debug_ap->dap);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not read DSCR register after queued instructions");
+		return retval;
+	}
+
+	/* the last instruction may still be in flight */
+	long long then = timeval_ms();
+	while ((dscr & DSCR_ITE) == 0) {
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("Timeout waiting for queued instructions");
+			return ERROR_FAIL;
+		}
+		retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	dpm->dscr = dscr;
+	if (dpm->last_el != ((dscr >> 8) & 3))
+		LOG_DEBUG("EL %i -> %" PRIu32, dpm->last_el, (dscr >> 8) & 3);
+	dpm->last_el = (dscr >> 8) & 3;
+
+	if (dscr & DSCR_ERR) {
+		LOG_ERROR("Queued instructions, DSCR.ERR=1, DSCR.EL=%i", dpm->last_el);
+		armv8_dpm_handle_exception(dpm, true);
+		return ERROR_FAIL;
+	}
+
+	if (dscr & (DSCR_ITO | DSCR_RTO | DSCR_TXU)) {
+		LOG_DEBUG("queued instructions overran the PE, dscr = 0x%08" PRIx32, dscr);
+		/* clear the sticky overrun/underrun flags */
+		retval = mem_ap_write_atomic_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
+		if (retval == ERROR_OK)
+			retval = ERROR_FAIL;
+		return retval;
+	}
+
+	return ERROR_OK;
+}
+
 static int dpmv8_instr_execute(struct arm_dpm *dpm, uint32_t opcode)
 {
 	return dpmv8_exec_opcode(dpm, opcode, NULL);
@@ -499,6 +576,10 @@ static int dpmv8_mrc(struct target *target, int cpnum,
 	struct arm_dpm *dpm = arm->dpm;
 	int retval;
 
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -524,6 +605,10 @@ static int dpmv8_mcr(struct target *target, int cpnum,
 	struct arm_dpm *dpm = arm->dpm;
 	int retval;
 
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -537,6 +622,9 @@ static int dpmv8_mcr(struct target *target, int cpnum,
 			ARMV4_5_MCR(cpnum, op1, 0, CRn, CRm, op2),
 			value);
 
+	/* the write may have changed the translation regime */
+	armv8_mmu_tlb_invalidate(dpm->arm->arch_info);
+
 	/* (void) */ dpm->finish(dpm);
 	return retval;
 }
@@ -595,6 +683,11 @@ static int dpmv8_mrs(struct target *target, uint32_t ns_requested, uint32_t op0,
 		(int) op1, (int) CRn,
 		(int) CRm, (int) op2);
 
+	/* complete a deferred debug entry before touching system registers */
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -685,6 +778,11 @@ static int dpmv8_msr(struct target *target, uint32_t ns_requested, uint32_t op0,
 		(int) op1, (int) CRn,
 		(int) CRm, (int) op2);
 
+	/* complete a deferred debug entry before touching system registers */
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -738,6 +836,9 @@ static int dpmv8_msr(struct target *target, uint32_t ns_requested, uint32_t op0,
 	retval = dpm->instr_write_data_r0_64(dpm,
 			ARMV8_MSR_INSTR(op0, op1, 0, CRn, CRm, op2), value);
 
+	/* the write may have changed the translation regime */
+	armv8_mmu_tlb_invalidate(dpm->arm->arch_info);
+
 fail:
 	if (restore_scr == true) {
 		/* need to restore scr_el3.ns before leaving */
@@ -918,7 +1019,9 @@ static int dpmv8_write_reg(struct arm_dpm *dpm, struct reg *r, unsigned regnum)
 		retval = armv8->write_reg_u64(armv8, regnum, value_64);
 
 		if (retval == ERROR_OK) {
-			r->dirty = false;
+			/* a queued write is only done once the queue is flushed */
+			if (!dpm->instr_queued)
+				r->dirty = false;
 			if (r->size == 64)
 				LOG_DEBUG("WRITE: %s, %16.8llx", r->name, (unsigned long long)value_64);
 			else
@@ -932,7 +1035,8 @@ static int dpmv8_write_reg(struct arm_dpm *dpm, struct reg *r, unsigned regnum)
 		retval = armv8->write_reg_u128(armv8, regnum, lvalue, hvalue);
 
 		if (retval == ERROR_OK) {
-			r->dirty = false;
+			if (!dpm->instr_queued)
+				r->dirty = false;
 
 			LOG_DEBUG("WRITE: %s, lvalue=%16.8llx", r->name, (unsigned long long) lvalue);
 			LOG_DEBUG("WRITE: %s, hvalue=%16.8llx", r->name, (unsigned long long) hvalue);
@@ -945,6 +1049,74 @@ static int dpmv8_write_reg(struct arm_dpm *dpm, struct reg *r, unsigned regnum)
 	return retval;
 }
 
+/*
+ * Read X0-X30, SP and PC of an AArch64 context, X1 onwards in a single
+ * queued batch. The batch uses X0 as scratch for SP and PC before its
+ * status is known, so X0 is read on its own first: that way a failed batch
+ * leaves nothing clobbered that the per-register path cannot read again.
+ */
+static int dpmv8_read_gprs_queued(struct arm_dpm *dpm)
+{
+	struct armv8_common *armv8 = dpm->arm->arch_info;
+	struct reg_cache *cache = dpm->arm->core_cache;
+	uint32_t lo[ARMV8_PC + 1], hi[ARMV8_PC + 1];
+	int retval = ERROR_OK;
+
+	if (!cache->reg_list[ARMV8_R0].valid) {
+		retval = dpmv8_read_reg(dpm, cache->reg_list + ARMV8_R0, ARMV8_R0);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	dpmv8_queue_begin(dpm);
+
+	for (unsigned int i = ARMV8_R1; i <= ARMV8_PC && retval == ERROR_OK; i++) {
+		if (cache->reg_list[i].valid)
+			continue;
+
+		switch (i) {
+		case ARMV8_SP:
+			retval = dpmv8_exec_opcode(dpm, ARMV8_MOVFSP_64(0), NULL);
+			break;
+		case ARMV8_PC:
+			retval = dpmv8_exec_opcode(dpm, ARMV8_MRS_DLR(0), NULL);
+			break;
+		default:
+			break;
+		}
+		if (retval == ERROR_OK)
+			retval = dpmv8_exec_opcode(dpm,
+					ARMV8_MSR_GP(SYSTEM_DBG_DBGDTR_EL0, i < ARMV8_SP ? i : 0), NULL);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRTX, &lo[i]);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRRX, &hi[i]);
+	}
+
+	if (retval == ERROR_OK)
+		retval = dpmv8_queue_flush(dpm);
+	else
+		dpm->instr_queued = false;
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = ARMV8_R1; i <= ARMV8_PC; i++) {
+		struct reg *r = cache->reg_list + i;
+
+		if (r->valid)
+			continue;
+
+		buf_set_u64(r->value, 0, 64, (uint64_t)hi[i] << 32 | lo[i]);
+		r->valid = true;
+		r->dirty = false;
+		LOG_DEBUG("READ: %s, %16.8" PRIx64, r->name, buf_get_u64(r->value, 0, 64));
+	}
+
+	return ERROR_OK;
+}
+
 /**
  * Read basic registers of the current context:  R0 to R15, and CPSR;
  * sets the core mode (such as USR or IRQ) and state (such as ARM or Thumb).
@@ -967,6 +1139,16 @@ int armv8_dpm_read_current_registers(struct arm_dpm *dpm)
 
 	cache = arm->core_cache;
 
+	/*
+	 * In AArch64 state fetch the general purpose registers in one batch;
+	 * fall back to the per-register path below if that fails.
+	 */
+	if (armv8_dpm_get_core_state(dpm) == ARM_STATE_AARCH64) {
+		retval = dpmv8_read_gprs_queued(dpm);
+		if (retval != ERROR_OK)
+			LOG_DEBUG("queued register read failed, retrying one by one");
+	}
+
 	/* read R0 first (it's used for scratch), then CPSR */
 	r = cache->reg_list + ARMV8_R0;
 	if (!r->valid) {
@@ -1028,6 +1210,75 @@ fail:
 	return retval;
 }
 
+/**
+ * Read only what is needed to describe a halted PE: R0 (used as scratch,
+ * so it is saved first), CPSR and PC. The rest of the context is left
+ * invalid and read by armv8_dpm_read_deferred_context() when needed.
+ */
+int armv8_dpm_read_pc_cpsr(struct arm_dpm *dpm)
+{
+	struct arm *arm = dpm->arm;
+	struct armv8_common *armv8 = (struct armv8_common *)arm->arch_info;
+	struct reg *r;
+	uint32_t cpsr;
+	int retval;
+
+	retval = dpm->prepare(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	r = arm->core_cache->reg_list + ARMV8_R0;
+	if (!r->valid) {
+		retval = dpmv8_read_reg(dpm, r, ARMV8_R0);
+		if (retval != ERROR_OK)
+			goto fail;
+	}
+	r->dirty = true;
+
+	retval = dpm->instr_read_data_r0(dpm,
+			armv8_opcode(armv8, READ_REG_DSPSR), &cpsr);
+	if (retval != ERROR_OK)
+		goto fail;
+
+	armv8_set_cpsr(arm, cpsr);
+
+	r = arm->core_cache->reg_list + ARMV8_PC;
+	if (!r->valid)
+		retval = dpmv8_read_reg(dpm, r, ARMV8_PC);
+
+fail:
+	dpm->finish(dpm);
+	return retval;
+}
+
+/**
+ * Complete a debug entry that was deferred with armv8_dpm_read_pc_cpsr():
+ * read the remaining registers of the current context and run the core
+ * specific post debug entry hook. Does nothing if the context is complete.
+ */
+int armv8_dpm_read_deferred_context(struct arm_dpm *dpm)
+{
+	struct armv8_common *armv8 = (struct armv8_common *)dpm->arm->arch_info;
+	struct target *target = dpm->arm->target;
+	int retval;
+
+	if (!armv8->context_deferred)
+		return ERROR_OK;
+
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	LOG_DEBUG("%s: reading deferred register context", target_name(target));
+
+	armv8->context_deferred = false;
+
+	retval = armv8_dpm_read_current_registers(dpm);
+	if (retval == ERROR_OK && armv8->post_debug_entry)
+		retval = armv8->post_debug_entry(target);
+
+	return retval;
+}
+
 /* Avoid needless I/O ... leave breakpoints and watchpoints alone
  * unless they're removed, or need updating because of single-stepping
  * or running debugger code.
@@ -1076,6 +1327,22 @@ done:
 
 static int dpmv8_add_breakpoint(struct target *target, struct breakpoint *bp);
 
+/* Dirty registers of the current EL, except PC, CPSR and the scratch R0 */
+static bool dpmv8_reg_needs_write(struct arm_dpm *dpm, struct reg *reg)
+{
+	struct arm_reg *r = reg->arch_info;
+
+	if (reg->number == ARMV8_R0 || reg->number == ARMV8_PC ||
+			reg->number == ARMV8_xPSR)
+		return false;
+	if (!reg->valid || !reg->dirty)
+		return false;
+
+	/* skip all registers not on the current EL */
+	return r->mode == ARM_MODE_ANY ||
+		dpm->last_el == armv8_curel_from_core_mode(r->mode);
+}
+
 /**
  * Writes all modified core registers for all processor modes.  In normal
  * operation this is called on exit from halting debug state.
@@ -1133,24 +1400,12 @@ int armv8_dpm_write_dirty_registers(struct arm_dpm *dpm, bool bpwp)
 	if (retval != ERROR_OK)
 		goto done;
 
+	/* post all register writes to the DAP queue, check the result once */
+	dpmv8_queue_begin(dpm);
+
 	/* check everything except our scratch register R0 */
 	for (unsigned i = 1; i < cache->num_regs; i++) {
-		struct arm_reg *r;
-
-		/* skip PC and CPSR */
-		if (i == ARMV8_PC || i == ARMV8_xPSR)
-			continue;
-		/* skip invalid */
-		if (!cache->reg_list[i].valid)
-			continue;
-		/* skip non-dirty */
-		if (!cache->reg_list[i].dirty)
-			continue;
-
-		/* skip all registers not on the current EL */
-		r = cache->reg_list[i].arch_info;
-		if (r->mode != ARM_MODE_ANY &&
-				dpm->last_el != armv8_curel_from_core_mode(r->mode))
+		if (!dpmv8_reg_needs_write(dpm, &cache->reg_list[i]))
 			continue;
 
 		retval = dpmv8_write_reg(dpm, &cache->reg_list[i], i);
@@ -1168,6 +1423,23 @@ int armv8_dpm_write_dirty_registers(struct arm_dpm *dpm, bool bpwp)
 		retval = dpmv8_write_reg(dpm, &cache->reg_list[0], 0);
 	if (retval == ERROR_OK)
 		dpm->instr_cpsr_sync(dpm);
+
+	if (retval == ERROR_OK)
+		retval = dpmv8_queue_flush(dpm);
+	else
+		dpm->instr_queued = false;
+
+	/* the writes only took effect with a successful flush; otherwise the
+	 * registers stay dirty, to be written again on the next attempt */
+	if (retval == ERROR_OK) {
+		for (unsigned i = 1; i < cache->num_regs; i++) {
+			if (dpmv8_reg_needs_write(dpm, &cache->reg_list[i]))
+				cache->reg_list[i].dirty = false;
+		}
+		cache->reg_list[ARMV8_xPSR].dirty = false;
+		cache->reg_list[ARMV8_PC].dirty = false;
+		cache->reg_list[ARMV8_R0].dirty = false;
+	}
 done:
 	dpm->finish(dpm);
 	return retval;
@@ -1190,6 +1462,13 @@ static int armv8_dpm_read_core_reg(struct target *target, struct reg *r,
 	if (regnum < 0 || regnum >= max)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	/* the first access to a deferred context fetches all of it */
+	retval = armv8_dpm_read_deferred_context(dpm);
+	if (retval != ERROR_OK)
+		return retval;
+	if (r->valid)
+		return ERROR_OK;
+
 	/*
 	 * REVISIT what happens if we try to read SPSR in a core mode
 	 * which has no such register?
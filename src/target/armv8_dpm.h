@@ -32,6 +32,8 @@ int armv8_dpm_setup(struct arm_dpm *dpm);
 int armv8_dpm_initialize(struct arm_dpm *dpm);
 
 int armv8_dpm_read_current_registers(struct arm_dpm *dpm);
+int armv8_dpm_read_pc_cpsr(struct arm_dpm *dpm);
+int armv8_dpm_read_deferred_context(struct arm_dpm *dpm);
 int armv8_dpm_modeswitch(struct arm_dpm *dpm, enum arm_mode mode);
 
 
@@ -87,6 +87,7 @@
 #define SYSTEM_DCCIVAC			0b0101101111110001
 
 #define SYSTEM_MPIDR			0b1100000000000101
+#define SYSTEM_ID_AA64ISAR0_EL1	0b1100000000110000
 
 #define SYSTEM_TCR_EL1			0b1100000100000010
 #define SYSTEM_TCR_EL2			0b1110000100000010
@@ -96,6 +97,12 @@
 #define SYSTEM_TTBR0_EL2		0b1110000100000000
 #define SYSTEM_TTBR0_EL3		0b1111000100000000
 #define SYSTEM_TTBR1_EL1		0b1100000100000001
+#define SYSTEM_TTBR1_EL2		0b1110000100000001
+
+#define SYSTEM_MAIR_EL2			0b1110010100010000
+#define SYSTEM_MAIR_EL3			0b1111010100010000
+
+#define SYSTEM_HCR_EL2			0b1110000010001000
 
 /* ARMv8 address translation */
 #define SYSTEM_PAR_EL1			0b1100001110100000
@@ -1019,36 +1019,69 @@ void image_close(struct image *image)
 	image->sections = NULL;
 }
 
-int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
-{
-	uint32_t crc = 0xffffffff;
-	LOG_DEBUG("Calculating checksum");
-
-	static uint32_t crc32_table[256];
+/* CRC32 as per gdb, tables for slice-by-8: crc32_table[k][i] is the CRC of
+ * byte i followed by k zero bytes */
+static uint32_t crc32_table[8][256];
 
+static void image_crc32_init(void)
+{
 	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		unsigned int i, j, c;
+	if (first_init)
+		return;
+
+	unsigned int i, j, k, c;
+	for (i = 0; i < 256; i++) {
+		/* as per gdb */
+		for (c = i << 24, j = 8; j > 0; --j)
+			c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
+		crc32_table[0][i] = c;
+	}
+	for (k = 1; k < 8; k++)
 		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
+			c = crc32_table[k - 1][i];
+			crc32_table[k][i] = (c << 8) ^ crc32_table[0][c >> 24];
 		}
 
-		first_init = true;
+	first_init = true;
+}
+
+static uint32_t image_crc32_update(uint32_t crc, const uint8_t *buffer, uint32_t nbytes)
+{
+	/* eight bytes per step: the first four are folded into the running
+	 * CRC, all eight then go through their own table */
+	while (nbytes >= 8) {
+		crc ^= (uint32_t)buffer[0] << 24 | (uint32_t)buffer[1] << 16
+			| (uint32_t)buffer[2] << 8 | buffer[3];
+		crc = crc32_table[7][crc >> 24] ^ crc32_table[6][(crc >> 16) & 255]
+			^ crc32_table[5][(crc >> 8) & 255] ^ crc32_table[4][crc & 255]
+			^ crc32_table[3][buffer[4]] ^ crc32_table[2][buffer[5]]
+			^ crc32_table[1][buffer[6]] ^ crc32_table[0][buffer[7]];
+		buffer += 8;
+		nbytes -= 8;
 	}
 
+	while (nbytes--) {
+		/* as per gdb */
+		crc = (crc << 8) ^ crc32_table[0][((crc >> 24) ^ *buffer++) & 255];
+	}
+
+	return crc;
+}
+
+int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+{
+	uint32_t crc = 0xffffffff;
+	LOG_DEBUG("Calculating checksum");
+
+	image_crc32_init();
+
 	while (nbytes > 0) {
-		int run = nbytes;
-		if (run > 32768)
-			run = 32768;
+		uint32_t run = nbytes;
+		if (run > 1024 * 1024)
+			run = 1024 * 1024;
+		crc = image_crc32_update(crc, buffer, run);
+		buffer += run;
 		nbytes -= run;
-		while (run--) {
-			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
-		}
 		keep_alive();
 	}
 
@@ -18,17 +18,34 @@
 #include "config.h"
 #endif
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "target.h"
 #include "target_type.h"
 #include "arm.h"
 #include "arm_adi.h"
 
 #include <jtag/jtag.h>
+#include <helper/time_support.h>
+
+/* An address range read by the background sampler */
+struct mem_ap_sample_range {
+	target_addr_t address;
+	uint32_t count;		/* in words */
+	uint8_t *buffer;
+};
 
 struct mem_ap {
 	struct arm arm;
 	struct adi_ap *ap;
 	int ap_num;
+
+	/* background sampler */
+	struct mem_ap_sample_range *sample_ranges;
+	unsigned int num_sample_ranges;
+	unsigned int sample_period;
+	FILE *sample_file;
 };
 
 static int mem_ap_target_create(struct target *target, Jim_Interp *interp)
@@ -67,10 +84,16 @@ static int mem_ap_init_target(struct command_context *cmd_ctx, struct target *ta
 	return ERROR_OK;
 }
 
+static void mem_ap_sample_stop(struct target *target);
+static void mem_ap_sample_clear(struct mem_ap *mem_ap);
+
 static void mem_ap_deinit_target(struct target *target)
 {
 	LOG_DEBUG("%s", __func__);
 
+	mem_ap_sample_stop(target);
+	mem_ap_sample_clear(target->arch_info);
+
 	free(target->private_config);
 	free(target->arch_info);
 	return;
@@ -175,9 +198,281 @@ static int mem_ap_write_memory(struct target *target, target_addr_t address,
 	return mem_ap_write_buf(mem_ap->ap, buffer, size, count, address);
 }
 
+/*
+ * Background memory sampler: a timer callback reads all registered ranges
+ * in one batch of DAP transactions and appends one record per range to the
+ * sample file. A record is a little endian header
+ *	uint64_t timestamp in microseconds
+ *	uint64_t address
+ *	uint32_t length in bytes
+ * followed by the data in target byte order.
+ */
+static int mem_ap_sample_callback(void *priv)
+{
+	struct target *target = priv;
+	struct mem_ap *mem_ap = target->arch_info;
+	struct adi_xfer *xfers;
+	struct timeval now;
+	int retval;
+
+	if (!target_was_examined(target) || !mem_ap->num_sample_ranges)
+		return ERROR_OK;
+
+	xfers = calloc(mem_ap->num_sample_ranges, sizeof(*xfers));
+	if (!xfers)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < mem_ap->num_sample_ranges; i++) {
+		xfers[i].ap = mem_ap->ap;
+		xfers[i].write = false;
+		xfers[i].buffer = mem_ap->sample_ranges[i].buffer;
+		xfers[i].size = 4;
+		xfers[i].count = mem_ap->sample_ranges[i].count;
+		xfers[i].address = mem_ap->sample_ranges[i].address;
+	}
+
+	retval = mem_ap_xfer_batch(mem_ap->arm.dap, xfers, mem_ap->num_sample_ranges);
+	free(xfers);
+
+	gettimeofday(&now, NULL);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("%s: sampling failed, stopped", target_name(target));
+		mem_ap_sample_stop(target);
+		return retval;
+	}
+
+	uint64_t timestamp = (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+
+	for (unsigned int i = 0; i < mem_ap->num_sample_ranges; i++) {
+		struct mem_ap_sample_range *range = &mem_ap->sample_ranges[i];
+		uint8_t header[20];
+
+		h_u64_to_le(header, timestamp);
+		h_u64_to_le(header + 8, range->address);
+		h_u32_to_le(header + 16, range->count * 4);
+
+		if (fwrite(header, sizeof(header), 1, mem_ap->sample_file) != 1
+				|| fwrite(range->buffer, range->count * 4, 1,
+					mem_ap->sample_file) != 1) {
+			LOG_ERROR("%s: writing samples failed, stopped", target_name(target));
+			mem_ap_sample_stop(target);
+			return ERROR_FAIL;
+		}
+	}
+
+	/* a reader of a named pipe that falls behind stops sampling too */
+	if (fflush(mem_ap->sample_file) == EOF) {
+		LOG_ERROR("%s: writing samples failed, stopped", target_name(target));
+		mem_ap_sample_stop(target);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static void mem_ap_sample_stop(struct target *target)
+{
+	struct mem_ap *mem_ap = target->arch_info;
+
+	if (!mem_ap->sample_file)
+		return;
+
+	target_unregister_timer_callback(mem_ap_sample_callback, target);
+	fclose(mem_ap->sample_file);
+	mem_ap->sample_file = NULL;
+}
+
+static void mem_ap_sample_clear(struct mem_ap *mem_ap)
+{
+	for (unsigned int i = 0; i < mem_ap->num_sample_ranges; i++)
+		free(mem_ap->sample_ranges[i].buffer);
+
+	free(mem_ap->sample_ranges);
+	mem_ap->sample_ranges = NULL;
+	mem_ap->num_sample_ranges = 0;
+}
+
+COMMAND_HANDLER(mem_ap_handle_sample_add_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_ap *mem_ap = target->arch_info;
+	struct mem_ap_sample_range *ranges;
+	target_addr_t address;
+	uint32_t length;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], length);
+
+	if ((address | length) & 3 || !length) {
+		command_print(CMD, "address and length must be non-zero multiples of 4");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	ranges = realloc(mem_ap->sample_ranges,
+			(mem_ap->num_sample_ranges + 1) * sizeof(*ranges));
+	if (!ranges) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	mem_ap->sample_ranges = ranges;
+
+	ranges[mem_ap->num_sample_ranges].address = address;
+	ranges[mem_ap->num_sample_ranges].count = length / 4;
+	ranges[mem_ap->num_sample_ranges].buffer = malloc(length);
+	if (!ranges[mem_ap->num_sample_ranges].buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	mem_ap->num_sample_ranges++;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(mem_ap_handle_sample_clear_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	mem_ap_sample_stop(target);
+	mem_ap_sample_clear(target->arch_info);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(mem_ap_handle_sample_list_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_ap *mem_ap = target->arch_info;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (unsigned int i = 0; i < mem_ap->num_sample_ranges; i++)
+		command_print(CMD, TARGET_ADDR_FMT " %" PRIu32,
+			mem_ap->sample_ranges[i].address,
+			mem_ap->sample_ranges[i].count * 4);
+
+	if (mem_ap->sample_file)
+		command_print(CMD, "sampling every %u ms", mem_ap->sample_period);
+	else
+		command_print(CMD, "sampling stopped");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(mem_ap_handle_sample_start_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_ap *mem_ap = target->arch_info;
+	unsigned int period;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], period);
+	if (!period)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (!mem_ap->num_sample_ranges) {
+		command_print(CMD, "no address ranges to sample");
+		return ERROR_FAIL;
+	}
+
+	mem_ap_sample_stop(target);
+
+#ifdef O_NONBLOCK
+	/* Never block the event loop on a named pipe: opening one that has no
+	 * reader fails, and so do writes to a full one. */
+	int fd = open(CMD_ARGV[1], O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+	mem_ap->sample_file = fd < 0 ? NULL : fdopen(fd, "wb");
+	if (fd >= 0 && !mem_ap->sample_file)
+		close(fd);
+#else
+	mem_ap->sample_file = fopen(CMD_ARGV[1], "wb");
+#endif
+	if (!mem_ap->sample_file) {
+		command_print(CMD, "cannot open %s", CMD_ARGV[1]);
+		return ERROR_FAIL;
+	}
+
+	mem_ap->sample_period = period;
+
+	return target_register_timer_callback(mem_ap_sample_callback, period,
+			TARGET_TIMER_TYPE_PERIODIC, target);
+}
+
+COMMAND_HANDLER(mem_ap_handle_sample_stop_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	mem_ap_sample_stop(target);
+
+	return ERROR_OK;
+}
+
+static const struct command_registration mem_ap_sample_command_handlers[] = {
+	{
+		.name = "add",
+		.handler = mem_ap_handle_sample_add_command,
+		.mode = COMMAND_ANY,
+		.help = "add an address range to the sampled ranges",
+		.usage = "address length",
+	},
+	{
+		.name = "clear",
+		.handler = mem_ap_handle_sample_clear_command,
+		.mode = COMMAND_ANY,
+		.help = "stop sampling and remove all ranges",
+		.usage = "",
+	},
+	{
+		.name = "list",
+		.handler = mem_ap_handle_sample_list_command,
+		.mode = COMMAND_ANY,
+		.help = "list the sampled ranges",
+		.usage = "",
+	},
+	{
+		.name = "start",
+		.handler = mem_ap_handle_sample_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "start sampling the ranges into a file",
+		.usage = "period_ms filename",
+	},
+	{
+		.name = "stop",
+		.handler = mem_ap_handle_sample_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop sampling",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration mem_ap_command_handlers[] = {
+	{
+		.name = "sample",
+		.mode = COMMAND_ANY,
+		.help = "background memory sampler",
+		.usage = "",
+		.chain = mem_ap_sample_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 struct target_type mem_ap_target = {
 	.name = "mem_ap",
 
+	.commands = mem_ap_command_handlers,
 	.target_create = mem_ap_target_create,
 	.init_target = mem_ap_init_target,
 	.deinit_target = mem_ap_deinit_target,
@@ -17,6 +17,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <helper/log.h>
 #include <helper/binarybuffer.h>
 #include <helper/command.h>
@@ -24,6 +25,42 @@
 
 #include "target.h"
 
+/* Host buffers used while polling, grown on demand. */
+static uint8_t *channel_buf;
+static size_t channel_buf_size;
+static uint8_t *data_buf;
+static size_t data_buf_size;
+
+static uint8_t *grow_buffer(uint8_t **buf, size_t *size, size_t length)
+{
+	uint8_t *tmp;
+
+	if (length <= *size)
+		return *buf;
+
+	tmp = realloc(*buf, length);
+
+	if (!tmp)
+		return NULL;
+
+	*buf = tmp;
+	*size = length;
+
+	return tmp;
+}
+
+static void parse_rtt_channel(const uint8_t *buf, target_addr_t address,
+		struct rtt_channel *channel)
+{
+	channel->address = address;
+	channel->name_addr = buf_get_u32(buf + 0, 0, 32);
+	channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
+	channel->size = buf_get_u32(buf + 8, 0, 32);
+	channel->write_pos = buf_get_u32(buf + 12, 0, 32);
+	channel->read_pos = buf_get_u32(buf + 16, 0, 32);
+	channel->flags = buf_get_u32(buf + 20, 0, 32);
+}
+
 static int read_rtt_channel(struct target *target,
 		const struct rtt_control *ctrl, unsigned int channel_index,
 		enum rtt_channel_type type, struct rtt_channel *channel)
@@ -42,13 +79,7 @@ static int read_rtt_channel(struct target *target,
 	if (ret != ERROR_OK)
 		return ret;
 
-	channel->address = address;
-	channel->name_addr = buf_get_u32(buf + 0, 0, 32);
-	channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
-	channel->size = buf_get_u32(buf + 8, 0, 32);
-	channel->write_pos = buf_get_u32(buf + 12, 0, 32);
-	channel->read_pos = buf_get_u32(buf + 16, 0, 32);
-	channel->flags = buf_get_u32(buf + 20, 0, 32);
+	parse_rtt_channel(buf, address, channel);
 
 	return ERROR_OK;
 }
@@ -61,6 +92,14 @@ int target_rtt_start(struct target *target, const struct rtt_control *ctrl,
 
 int target_rtt_stop(struct target *target, void *user_data)
 {
+	free(channel_buf);
+	channel_buf = NULL;
+	channel_buf_size = 0;
+
+	free(data_buf);
+	data_buf = NULL;
+	data_buf_size = 0;
+
 	return ERROR_OK;
 }
 
@@ -379,24 +418,52 @@ int target_rtt_read_callback(struct target *target,
 		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
 		size_t num_channels, void *user_data)
 {
+	int ret;
+	unsigned int length_max;
+
 	num_channels = MIN(num_channels, ctrl->num_up_channels);
 
+	/* Only fetch descriptors up to the last channel with a sink. */
+	while (num_channels && !sinks[num_channels - 1])
+		num_channels--;
+
+	if (!num_channels)
+		return ERROR_OK;
+
+	ret = rtt_get_buffer_size(&length_max);
+
+	if (ret != ERROR_OK)
+		return ret;
+
+	if (!grow_buffer(&channel_buf, &channel_buf_size,
+			num_channels * RTT_CHANNEL_SIZE)
+			|| !grow_buffer(&data_buf, &data_buf_size, length_max)) {
+		LOG_ERROR("rtt: Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/*
+	 * The up-channel descriptors are laid out back to back after the
+	 * control block, fetch all of them in a single block read.
+	 */
+	ret = target_read_buffer(target, ctrl->address + RTT_CB_SIZE,
+		num_channels * RTT_CHANNEL_SIZE, channel_buf);
+
+	if (ret != ERROR_OK) {
+		LOG_ERROR("rtt: Failed to read up-channel descriptions");
+		return ret;
+	}
+
 	for (size_t i = 0; i < num_channels; i++) {
-		int ret;
 		struct rtt_channel channel;
-		uint8_t buffer[1024];
+		uint32_t level;
 		size_t length;
 
 		if (!sinks[i])
 			continue;
 
-		ret = read_rtt_channel(target, ctrl, i, RTT_CHANNEL_TYPE_UP,
-			&channel);
-
-		if (ret != ERROR_OK) {
-			LOG_ERROR("rtt: Failed to read up-channel %zu description", i);
-			return ret;
-		}
+		parse_rtt_channel(channel_buf + i * RTT_CHANNEL_SIZE,
+			ctrl->address + RTT_CB_SIZE + i * RTT_CHANNEL_SIZE, &channel);
 
 		if (!channel_is_active(&channel)) {
 			LOG_WARNING("rtt: Up-channel %zu is not active", i);
@@ -408,16 +475,27 @@ int target_rtt_read_callback(struct target *target,
 			continue;
 		}
 
-		length = sizeof(buffer);
-		ret = read_from_channel(target, &channel, buffer, &length);
+		level = (channel.write_pos + channel.size - channel.read_pos)
+			% channel.size;
+
+		/* nothing new, skip without touching the target again */
+		if (!level) {
+			rtt_update_channel_stats(i, channel.size, 0, 0);
+			continue;
+		}
+
+		length = length_max;
+		ret = read_from_channel(target, &channel, data_buf, &length);
 
 		if (ret != ERROR_OK) {
 			LOG_ERROR("rtt: Failed to read from up-channel %zu", i);
 			return ret;
 		}
 
+		rtt_update_channel_stats(i, channel.size, level, length);
+
 		for (struct rtt_sink_list *sink = sinks[i]; sink; sink = sink->next)
-			sink->read(i, buffer, length, sink->user_data);
+			sink->read(i, data_buf, length, sink->user_data);
 	}
 
 	return ERROR_OK;
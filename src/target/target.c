@@ -157,6 +157,9 @@ static struct target_timer_callback *target_timer_callbacks;
 static LIST_HEAD(target_reset_callback_list);
 static LIST_HEAD(target_trace_callback_list);
 static const int polling_interval = 100;
+/* upper bound, in ms, for the poll interval of an idle target; the default
+ * of one polling_interval (or 0) polls every target on every tick */
+static unsigned int polling_idle_max = 100;
 
 static const Jim_Nvp nvp_assert[] = {
 	{ .name = "assert", NVP_ASSERT },
@@ -1797,6 +1800,10 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 
 	target_handle_event(target, event);
 
+	/* something happened on this target, go back to polling it at full rate */
+	target->idle_backoff.times = 0;
+	target->idle_backoff.count = 0;
+
 	while (callback) {
 		next_callback = callback->next;
 		callback->callback(target, event, callback->priv);
@@ -2975,8 +2982,17 @@ static int handle_target(void *priv)
 		}
 		target->backoff.count = 0;
 
+		if (target->idle_backoff.times > target->idle_backoff.count) {
+			/* nothing attached and nothing changed lately, skip this tick */
+			target->idle_backoff.count++;
+			continue;
+		}
+		target->idle_backoff.count = 0;
+
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!powerDropout && !srstAsserted) {
+			enum target_state prev_state = target->state;
+
 			/* polling may fail silently until the target has been examined */
 			retval = target_poll(target);
 			if (retval != ERROR_OK) {
@@ -3007,6 +3023,18 @@ static int handle_target(void *priv)
 
 			/* Since we succeeded, we reset backoff count */
 			target->backoff.times = 0;
+
+			/* Keep polling at full rate while gdb is attached to this target
+			 * (or to its SMP group) or its state just changed; otherwise
+			 * double the interval up to polling_idle_max. */
+			if ((target->gdb_service && target->gdb_service->connections > 0)
+					|| target->state != prev_state) {
+				target->idle_backoff.times = 0;
+			} else if ((target->idle_backoff.times + 1) * 2 * polling_interval
+					<= (int)polling_idle_max) {
+				target->idle_backoff.times *= 2;
+				target->idle_backoff.times++;
+			}
 		}
 	}
 
@@ -3169,6 +3197,23 @@ COMMAND_HANDLER(handle_poll_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_poll_idle_max_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], polling_idle_max);
+		for (struct target *target = all_targets; target; target = target->next) {
+			target->idle_backoff.times = 0;
+			target->idle_backoff.count = 0;
+		}
+	}
+
+	command_print(CMD, "idle polling interval limit: %ums", polling_idle_max);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_wait_halt_command)
 {
 	if (CMD_ARGC > 1)
@@ -3664,12 +3709,17 @@ COMMAND_HANDLER(handle_load_image_command)
 
 }
 
+/* dump_image reads in large chunks so the adapter can queue long bursts */
+#define DUMP_IMAGE_CHUNK	(256 * 1024)
+#define DUMP_IMAGE_PROGRESS	(64 * 1024 * 1024)
+
 COMMAND_HANDLER(handle_dump_image_command)
 {
 	struct fileio *fileio;
 	uint8_t *buffer;
 	int retval, retvaltemp;
-	target_addr_t address, size;
+	target_addr_t address, size, total, done = 0;
+	target_addr_t next_progress = DUMP_IMAGE_PROGRESS;
 	struct duration bench;
 	struct target *target = get_current_target(CMD_CTX);
 
@@ -3679,7 +3729,7 @@ COMMAND_HANDLER(handle_dump_image_command)
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[2], size);
 
-	uint32_t buf_size = (size > 4096) ? 4096 : size;
+	uint32_t buf_size = (size > DUMP_IMAGE_CHUNK) ? DUMP_IMAGE_CHUNK : size;
 	buffer = malloc(buf_size);
 	if (!buffer)
 		return ERROR_FAIL;
@@ -3691,6 +3741,7 @@ COMMAND_HANDLER(handle_dump_image_command)
 	}
 
 	duration_start(&bench);
+	total = size;
 
 	while (size > 0) {
 		size_t size_written;
@@ -3705,6 +3756,17 @@ COMMAND_HANDLER(handle_dump_image_command)
 
 		size -= this_run_size;
 		address += this_run_size;
+		done += this_run_size;
+
+		if (done >= next_progress && size > 0
+				&& duration_measure(&bench) == ERROR_OK) {
+			LOG_INFO("dumped %" PRIu64 " of %" PRIu64 " bytes (%0.3f KiB/s)",
+					(uint64_t)done, (uint64_t)total,
+					duration_kbps(&bench, done));
+			next_progress += DUMP_IMAGE_PROGRESS;
+		}
+
+		keep_alive();
 	}
 
 	free(buffer);
@@ -4141,7 +4203,7 @@ static void writeString(FILE *f, char *s)
 typedef unsigned char UNIT[2];  /* unit of profiling */
 
 /* Dump a gmon.out histogram file. */
-static void write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filename, bool with_range,
+void target_write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filename, bool with_range,
 			uint32_t start_address, uint32_t end_address, struct target *target, uint32_t duration_ms)
 {
 	uint32_t i;
@@ -4316,7 +4378,7 @@ COMMAND_HANDLER(handle_profile_command)
 		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[3], end_address);
 	}
 
-	write_gmon(samples, num_of_samples, CMD_ARGV[1],
+	target_write_gmon(samples, num_of_samples, CMD_ARGV[1],
 		   with_range, start_address, end_address, target, duration_ms);
 	command_print(CMD, "Wrote %s", CMD_ARGV[1]);
 
@@ -6448,6 +6510,14 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "poll target state; or reconfigure background polling",
 		.usage = "['on'|'off']",
 	},
+	{
+		.name = "poll_idle_max",
+		.handler = handle_poll_idle_max_command,
+		.mode = COMMAND_ANY,
+		.help = "display or set the longest interval, in ms, between "
+			"background polls of an idle target",
+		.usage = "[milliseconds]",
+	},
 	{
 		.name = "wait_halt",
 		.handler = handle_wait_halt_command,
@@ -111,6 +111,8 @@ struct gdb_service {
 	/*  element 1 coreid to be displayed at next resume 1 till n 0 means resume
 	 *  all cores core displayed  */
 	int32_t core[2];
+	/* number of gdb connections currently open on this service */
+	int connections;
 };
 
 /* target back off timer */
@@ -198,6 +200,8 @@ struct target {
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
 	struct backoff_timer backoff;
+	struct backoff_timer idle_backoff;	/* stretches background polling while
+										 * nothing is attached or changing */
 	int smp;							/* add some target attributes for smp support */
 	struct target_list *head;
 	/* the gdb service is there in case of smp, we have only one gdb server
@@ -764,6 +768,9 @@ void target_handle_md_output(struct command_invocation *cmd,
 
 int target_profiling_default(struct target *target, uint32_t *samples, uint32_t
 		max_num_samples, uint32_t *num_samples, uint32_t seconds);
+void target_write_gmon(uint32_t *samples, uint32_t sampleNum, const char *filename,
+		bool with_range, uint32_t start_address, uint32_t end_address,
+		struct target *target, uint32_t duration_ms);
 
 #define ERROR_TARGET_INVALID	(-300)
 #define ERROR_TARGET_INIT_FAILED (-301)